@@ -0,0 +1,275 @@
+/* Bridge application build options */
+#ifndef BRIDGE_CONFIG_H
+#define BRIDGE_CONFIG_H
+
+// <<< Use Configuration Wizard in Context Menu >>>
+
+// <h> Debug log settings
+// <o> Deferred log ring size (records, power of 2)
+// <i> Records that do not fit are dropped and counted, never waited for
+// <id> dlog_ring_size
+#ifndef DLOG_RING_SIZE
+#define DLOG_RING_SIZE 16
+#endif
+
+// <o> Maximum formatted log line length
+// <id> dlog_line_size
+#ifndef DLOG_LINE_SIZE
+#define DLOG_LINE_SIZE 48
+#endif
+// </h>
+
+// <h> Binary telemetry settings
+// <q> Build the COBS framed telemetry stream on USART3
+// <id> telemetry_enable
+#ifndef TELEMETRY_ENABLE
+#define TELEMETRY_ENABLE 1
+#endif
+
+// <q> Send telemetry frames from reset
+// <i> Otherwise it is off until switched on at run time
+// <id> telemetry_default_on
+#ifndef TELEMETRY_DEFAULT_ON
+#define TELEMETRY_DEFAULT_ON 0
+#endif
+
+// <o> Telemetry frame period (ms)
+// <id> telemetry_period_ms
+#ifndef TELEMETRY_PERIOD_MS
+#define TELEMETRY_PERIOD_MS 1000
+#endif
+// </h>
+
+// <h> Memory
+// <o> USART ring pool size (bytes) <256-4096>
+// <i> Shared by all eight USART rings and reassigned between them at
+// <i> each bridge phase, see ringplan.c. The biggest layout there takes
+// <i> 1280; a smaller pool halves every ring until it fits
+// <id> usart_ring_pool
+#ifndef USART_RING_POOL
+#define USART_RING_POOL 1280
+#endif
+
+// <o> Most unread RX bytes a ring resize will carry over per USART
+// <id> usart_ring_stash
+#ifndef USART_RING_STASH
+#define USART_RING_STASH 16
+#endif
+// </h>
+
+// <h> Performance
+// <q> Assembler ISRs for the bridged USARTs
+// <i> Uses src/usart_relay.S for USART0 and USART2 RX/UDRE instead of the
+// <i> C ISRs; reserves GPIOR0..2. Cannot be combined with the
+// <i> instrumentation options below
+// <id> usart_asm_isr
+#ifndef USART_ASM_ISR
+#define USART_ASM_ISR 0
+#endif
+// </h>
+
+// <h> Bridges
+// <q> Second bridge, PC on USART1 to LCD on USART3
+// <i> Runs two independent bridges from one loop (bridge.c). Every USART
+// <i> is then bridged, so there is no debug log, telemetry or shell
+// <id> bridge_dual
+#ifndef BRIDGE_DUAL
+#define BRIDGE_DUAL 0
+#endif
+// </h>
+
+// <h> Broadcast upload
+// <o> Display stall timeout (ms) <50-10000>
+// <i> A display whose TX ring stays full this long while the others have
+// <i> room is dropped from a broadcast upload
+// <id> fanout_stall_ms
+#ifndef FANOUT_STALL_MS
+#define FANOUT_STALL_MS 1000
+#endif
+
+// <o> Display ack timeout (ms) <100-20000>
+// <i> A display still missing a chunk ack this long after another display
+// <i> acked it is dropped from a broadcast upload
+// <id> fanout_ack_ms
+#ifndef FANOUT_ACK_MS
+#define FANOUT_ACK_MS 3000
+#endif
+// </h>
+
+// <h> Re-arm
+// <o> Restart wait after a flash (ms) <500-30000>
+// <i> How long a display that was just flashed has to send its startup
+// <i> return at the baud it powers up at, before every baud is searched
+// <id> rearm_wait_ms
+#ifndef REARM_WAIT_MS
+#define REARM_WAIT_MS 5000
+#endif
+// </h>
+
+// <h> Baud follow
+// <q> Follow baud= and bauds= from the host
+// <i> Outside uploads, once a baud= or bauds= command has gone out to the
+// <i> display, the display's USART is moved to the new rate, so a host app
+// <i> can change speed without losing the link. Either host, with host2
+// <id> baud_follow
+#ifndef BAUD_FOLLOW
+#define BAUD_FOLLOW 1
+#endif
+
+// <q> Move the host's port too
+// <i> The port of the host that sent it (the PC or host2), as a host wired
+// <i> straight to the display would. Off, it stays where it is, the PC's
+// <i> until the next upload ends
+// <id> baud_follow_pc
+#ifndef BAUD_FOLLOW_PC
+#define BAUD_FOLLOW_PC 1
+#endif
+// </h>
+
+// <h> Shared LCD
+// <o> Control host frames per turn <1-255>
+// <i> When both hosts have a command waiting, the control host (the PC on
+// <i> USART0) sends this many for each one from the second host.
+// <i> Default for set prio
+// <id> arb_prio
+#ifndef ARB_PRIO
+#define ARB_PRIO 2
+#endif
+
+// <o> Host hold timeout (ms) <10-5000>
+// <i> A host that goes quiet this long part way through a command loses
+// <i> the LCD, and the command is ended for it
+// <id> arb_hold_ms
+#ifndef ARB_HOLD_MS
+#define ARB_HOLD_MS 200
+#endif
+// </h>
+
+// <h> Local TFT store
+// <q> Copy uploads to an SD card
+// <i> SD card on the SPI port, chip select on SS (pin 53). Every upload
+// <i> bridge 0 forwards is also written to the card and catalogued by
+// <i> size, CRC-32 and display model; see tftstore.h. Uses 2KB of the
+// <i> upload arena while copying, and 1KB more to flash from the card
+// <id> tft_store
+#ifndef TFT_STORE
+#define TFT_STORE 0
+#endif
+
+// <q> Flash button
+// <i> A button from pin 22 (PA0) to ground flashes the display from the
+// <i> card or the built in image, like the shell's flash command
+// <id> replay_button
+#ifndef REPLAY_BUTTON
+#define REPLAY_BUTTON 0
+#endif
+
+// <o> Baud switch timeout (ms) <100-10000>
+// <i> How long a display has to ack whmi-wri at a new baud before the
+// <i> next one down is tried
+// <id> replay_switch_ms
+#ifndef REPLAY_SWITCH_MS
+#define REPLAY_SWITCH_MS 1000
+#endif
+
+// <o> Chunk ack timeout (ms) <500-30000>
+// <i> How long a display has to ack each 4096 byte chunk when flashing
+// <i> from the card
+// <id> replay_ack_ms
+#ifndef REPLAY_ACK_MS
+#define REPLAY_ACK_MS 5000
+#endif
+// </h>
+
+// <h> Packed upload
+// <q> Take LZSS packed uploads from nexdelta -z
+// <i> The PC sends each 4096 byte chunk packed and the bridge unpacks it
+// <i> into the display at its own baud, paced by its 0x05 acks; see
+// <i> delta_proto.h. Works with or without the SD card store. Uses 256
+// <i> bytes of the upload arena for the window
+// <id> packed_upload
+#ifndef PACKED_UPLOAD
+#define PACKED_UPLOAD 1
+#endif
+// </h>
+
+// <h> Upload check
+// <q> Check an upload is for the display before it gets any of it
+// <i> The whmi-wri size against the flash size in each display's comok
+// <i> reply, then (bridge 0) the model named in the TFT header against
+// <i> its model, with the start of the file held back until it passes;
+// <i> see tftcheck.h. A file that fails is logged and goes no further
+// <id> tft_check
+#ifndef TFT_CHECK
+#define TFT_CHECK 1
+#endif
+
+// <o> Header bytes checked <16-256>
+// <i> Held in the upload arena, over what only a replay uses
+// <id> tft_head_len
+#ifndef TFT_HEAD_LEN
+#define TFT_HEAD_LEN 256
+#endif
+// </h>
+
+// <h> Embedded TFT
+// <q> Build a TFT image into flash
+// <i> src/embedded_tft.S pulls the file in after the code, where it can
+// <i> use what is left of the 256KB. It is flashed onto the display like
+// <i> an image from the SD card, by the shell's flash rom or the button
+// <id> embed_tft
+#ifndef EMBED_TFT
+#define EMBED_TFT 0
+#endif
+
+// <s> Image file
+// <i> On the assembler include path, e.g. the project directory
+// <id> embed_tft_file
+#ifndef EMBED_TFT_FILE
+#define EMBED_TFT_FILE "panel.tft"
+#endif
+
+// <s> Display model it is for
+// <i> As in the display's comok reply, e.g. NX4832T035_011R; it is only
+// <i> sent to that model. Empty to send it to any
+// <id> embed_tft_model
+#ifndef EMBED_TFT_MODEL
+#define EMBED_TFT_MODEL ""
+#endif
+
+// <q> Flash it on the first boot
+// <i> Flash the display once found after a reset, unless this image has
+// <i> already been flashed from here (a stamp of it is kept in EEPROM)
+// <id> embed_tft_boot
+#ifndef EMBED_TFT_BOOT
+#define EMBED_TFT_BOOT 1
+#endif
+// </h>
+
+// <h> Instrumentation
+// <q> Per-byte forwarding latency histogram
+// <i> Timestamps every bridged byte at RX and again as it goes into UDR;
+// <i> costs about 1KB of SRAM and some cycles in each ISR
+// <id> latency_hist
+#ifndef LATENCY_HIST
+#define LATENCY_HIST 0
+#endif
+// <q> ISR cycle cost profiler
+// <i> Times the USART and timer 5 ISRs with timer 5; adds about 50
+// <i> cycles to each of them
+// <id> profile_isr
+#ifndef PROFILE_ISR
+#define PROFILE_ISR 0
+#endif
+// <q> CPU load meter
+// <i> Splits each second into ISR, work and idle time and counts upload
+// <i> loop passes; uses the ISR profiler hooks for the ISR share
+// <id> cpu_load
+#ifndef CPU_LOAD
+#define CPU_LOAD 0
+#endif
+// </h>
+
+// <<< end of configuration section >>>
+
+#endif // BRIDGE_CONFIG_H
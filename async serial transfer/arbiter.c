@@ -0,0 +1,257 @@
+// Two hosts to one LCD, see arbiter.h
+// Host frames are cut through a byte at a time as the LCD rings have room,
+// never stored, so a long command costs no RAM and adds no latency.
+
+#include <atmel_start.h>
+#include <string.h>
+#include <bridge_config.h>
+#include "bridge.h"
+#include "dlog.h"
+#include "arbiter.h"
+
+// Nextion return frame length from its first byte, 0 when it has to be
+// found by its terminator. The fixed ones can have 0xff in their data.
+static uint8_t reply_len(uint8_t code)
+{
+	switch (code)
+	{
+	case 0x65:		// touch: page, component, event
+		return(7);
+	case 0x66:		// sendme: page
+		return(5);
+	case 0x67:		// touch coordinates, awake and asleep
+	case 0x68:
+		return(9);
+	case 0x71:		// get number: 4 bytes
+		return(8);
+	default:
+		return(0);
+	}
+}
+
+// frames that are not an answer to anyone's command
+static bool reply_event(uint8_t code)
+{
+	switch (code)
+	{
+	case 0x00:		// startup (00 00 00), or invalid instruction which is as likely theirs
+	case 0x24:		// LCD serial buffer overflow, every host has to back off
+	case 0x65:
+	case 0x67:
+	case 0x68:
+	case 0x86:		// sleep
+	case 0x87:		// wake
+	case 0x88:		// ready
+	case 0x89:		// SD card upgrade
+		return(true);
+	default:
+		return(false);
+	}
+}
+
+static bool lcds_room(const struct arbiter *a)
+{
+	uint8_t port;
+
+	for (port = 0; port < NPORTS; port++)
+	{
+		if ((a->lcds & (1 << port)) && !ports[port].tx_ready())
+		{
+			return(false);
+		}
+	}
+	return(true);
+}
+
+static void lcds_write(const struct arbiter *a, uint8_t ch)
+{
+	uint8_t port;
+
+	for (port = 0; port < NPORTS; port++)
+	{
+		if (a->lcds & (1 << port))
+		{
+			ports[port].write(ch);
+		}
+	}
+}
+
+void arb_init(struct arbiter *a, uint8_t control, uint8_t other, uint8_t lcds, uint8_t lcd,
+		uint8_t prio, uint8_t (*seen)(void *, uint8_t, uint8_t), void *ctx)
+{
+	memset(a, 0, sizeof *a);
+	a->hosts[0] = control;
+	a->hosts[1] = other;
+	a->lcds = lcds;
+	a->lcd = lcd;
+	a->prio = prio ? prio : 1;
+	a->credit = a->prio;
+	a->grant = -1;
+	a->seen = seen;
+	a->ctx = ctx;
+}
+
+// pick the next host to send a frame: the control host until its credit
+// is used up, as long as the other one has something waiting
+static void arb_pick(struct arbiter *a)
+{
+	bool w0, w1;
+
+	w0 = ports[a->hosts[0]].rx_ready();
+	w1 = ports[a->hosts[1]].rx_ready();
+	if (w1 && (!w0 || (a->credit == 0)))
+	{
+		a->grant = 1;
+		a->credit = a->prio;
+	}
+	else if (w0)
+	{
+		a->grant = 0;
+		if (w1)
+		{
+			a->credit--;
+		}
+	}
+	else
+	{
+		return;
+	}
+	a->term = 0;
+	a->last = (uint32_t)msectime();
+}
+
+// host frames to the LCDs, as far as the rings allow
+static void arb_down(struct arbiter *a, uint8_t *res)
+{
+	const struct port *host;
+	bool moved;
+	uint8_t ch, seen;
+
+	for (;;)
+	{
+		if (a->grant < 0)
+		{
+			arb_pick(a);
+			if (a->grant < 0)
+			{
+				return;
+			}
+		}
+		host = &ports[a->hosts[a->grant]];
+		moved = false;
+		while (host->rx_ready() && lcds_room(a))
+		{
+			ch = host->read();
+			seen = a->seen ? a->seen(a->ctx, a->grant, ch) : 0;
+			if (!(seen & ARB_SEEN_KEEP))
+			{
+				lcds_write(a, ch);
+			}
+			moved = true;
+			a->term = (ch == 0xff) ? a->term + 1 : 0;
+			if (a->term == 3)
+			{
+				a->frames[a->grant]++;
+				a->owner = a->grant;
+				a->grant = -1;
+				*res |= ARB_FRAME;
+			}
+			if (seen & ARB_SEEN_STOP)		// with the frame closed, so the arbiter can carry on afterwards
+			{
+				*res |= ARB_BUSY | ARB_STOP;
+				return;
+			}
+			if (a->term == 3)
+			{
+				break;
+			}
+		}
+		if (moved)
+		{
+			*res |= ARB_BUSY;
+		}
+		if (a->grant >= 0)		// mid frame, out of bytes or room
+		{
+			break;
+		}
+	}
+
+	// a host that stops part way through a frame would hold the LCD for
+	// good; end the frame for it so the LCD throws it away, and move on
+	if (moved)
+	{
+		a->last = (uint32_t)msectime();
+	}
+	else if (!host->rx_ready() && ((uint32_t)msectime() - a->last >= ARB_HOLD_MS))
+	{
+		while (a->term < 3)
+		{
+			lcds_write(a, 0xff);
+			a->term++;
+		}
+		a->cut++;
+		dlog2(DL_ARB_CUT, a->hosts[a->grant], a->cut);
+		a->grant = -1;
+		*res |= ARB_BUSY;
+	}
+}
+
+// LCD frames back to the host that asked, or to all of them
+static void arb_up(struct arbiter *a, uint8_t *res)
+{
+	const struct port *lcd = &ports[a->lcd];
+	uint8_t i, ch;
+
+	// every host needs room, the first byte decides who gets the frame
+	while (lcd->rx_ready() && ports[a->hosts[0]].tx_ready() && ports[a->hosts[1]].tx_ready())
+	{
+		ch = lcd->read();
+		*res |= ARB_BUSY;
+		if (a->route == 0)		// start of a frame
+		{
+			if (reply_event(ch))
+			{
+				a->route = (1 << ARB_HOSTS) - 1;
+				a->events++;
+			}
+			else
+			{
+				a->route = 1 << a->owner;
+				a->replies++;
+			}
+			a->left = reply_len(ch);
+			a->rterm = 0;
+		}
+		for (i = 0; i < ARB_HOSTS; i++)
+		{
+			if (a->route & (1 << i))
+			{
+				ports[a->hosts[i]].write(ch);
+			}
+		}
+		if (a->left)
+		{
+			if (--a->left == 0)
+			{
+				a->route = 0;
+			}
+		}
+		else
+		{
+			a->rterm = (ch == 0xff) ? a->rterm + 1 : 0;
+			if (a->rterm == 3)
+			{
+				a->route = 0;
+			}
+		}
+	}
+}
+
+uint8_t arb_run(struct arbiter *a)
+{
+	uint8_t res = 0;
+
+	arb_up(a, &res);
+	arb_down(a, &res);
+	return(res);
+}
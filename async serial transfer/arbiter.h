@@ -0,0 +1,63 @@
+// Two hosts sharing one Nextion outside of uploads
+//
+// Host commands are whole frames ending in 0xff 0xff 0xff. The LCD is
+// granted to one host at a time for one frame, which goes straight
+// through; the other host's bytes wait in its RX ring meanwhile, so frames
+// never mix. When both have frames waiting the control host (hosts[0])
+// gets prio frames for each one from the other.
+//
+// LCD returns are split into frames too. Replies to a command (return
+// codes, get data, sendme) go to the host that sent the last command.
+// Events nobody asked for (touch, sleep, wake, startup) go to every host.
+
+#ifndef ARBITER_H_INCLUDED
+#define ARBITER_H_INCLUDED
+
+#include <compiler.h>
+#include "ports.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ARB_HOSTS	2
+
+// arb_run() result bits
+#define ARB_BUSY	0x01		// moved something
+#define ARB_FRAME	0x02		// a host frame went to the LCD
+#define ARB_STOP	0x04		// seen() asked to stop: a host wants the LCD to itself, or the bridge needs a pause
+
+// seen() result bits
+#define ARB_SEEN_STOP	0x01	// stop after this byte
+#define ARB_SEEN_KEEP	0x02	// the hook keeps the byte, it doesn't go to the LCD
+
+struct arbiter {
+	uint8_t hosts[ARB_HOSTS];		// ports, hosts[0] is the control host
+	uint8_t lcds;					// displays commands go to, bit per port
+	uint8_t lcd;					// the one whose returns are routed
+	uint8_t prio;					// control host frames per turn when both are waiting
+	int8_t grant;					// host sending a frame now, -1 for none
+	uint8_t credit;					// control host frames left this turn
+	uint8_t term;					// 0xff bytes in a row in the frame being sent
+	uint32_t last;					// msectime() of its last byte
+	uint8_t owner;					// host that gets the replies, and sent what seen() stopped on
+	uint8_t route;					// hosts the LCD frame being read goes to, bit per host
+	uint8_t left;					// its bytes still to come, 0 to look for the terminator
+	uint8_t rterm;
+	uint32_t frames[ARB_HOSTS];		// host frames sent to the LCD
+	uint32_t replies;				// LCD frames routed to one host
+	uint32_t events;				// LCD frames sent to all of them
+	uint16_t cut;					// frames cut off when a host went quiet part way
+	uint8_t (*seen)(void *ctx, uint8_t host, uint8_t ch);	// every host byte, host 0 or 1, ARB_SEEN_xxx bits; may be NULL
+	void *ctx;
+};
+
+void arb_init(struct arbiter *a, uint8_t control, uint8_t other, uint8_t lcds, uint8_t lcd,
+		uint8_t prio, uint8_t (*seen)(void *, uint8_t, uint8_t), void *ctx);
+uint8_t arb_run(struct arbiter *a);		// ARB_xxx bits
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARBITER_H_INCLUDED */
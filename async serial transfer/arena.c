@@ -0,0 +1,8 @@
+// Upload phase SRAM arena, see arena.h
+
+#include <atmel_start.h>
+#include "arena.h"
+
+#if ARENA_USED
+struct bridge_arena arena;
+#endif
@@ -0,0 +1,64 @@
+// One static SRAM arena for the upload phase's buffers
+// Discovery and the Editor handshake used to overlay their buffers here;
+// they now parse bytes as they arrive and keep what they need (the LCD
+// signature) in their bridge context, so the arena is the upload's. It
+// holds only the buffers the build has a use for, so its size
+// (ARENA_SIZE) follows the options in bridge_config.h. A whmi-wri upload
+// and a replay (flash or delta) never run at once, so what only one of
+// them uses is overlaid; the SD card capture is used by both.
+
+#ifndef ARENA_H_INCLUDED
+#define ARENA_H_INCLUDED
+
+#include <compiler.h>
+#include <bridge_config.h>
+#include "blockdev.h"
+#include "lzss.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ARENA_REPLAY	(TFT_STORE || EMBED_TFT || PACKED_UPLOAD)	// replay.c is built
+#define ARENA_USED		(ARENA_REPLAY || TFT_CHECK)
+
+#if ARENA_USED
+
+struct bridge_arena {			// PH_UPLOAD, bridge 0 only
+#if TFT_STORE
+	uint8_t win[BLOCK_SIZE];	// FAT and directory sector
+	uint8_t buf[BLOCK_SIZE];	// image data sectors, capturing: one filling while the other waits for the card
+	uint8_t cap[BLOCK_SIZE];
+	uint8_t sums[BLOCK_SIZE];	// its chunk CRCs
+#endif
+	union {
+#if TFT_CHECK
+		uint8_t head[TFT_HEAD_LEN];	// whmi-wri upload being checked, the start of the file
+#endif
+#if ARENA_REPLAY
+		struct {
+#if TFT_STORE
+			uint8_t read[2][BLOCK_SIZE];	// flashing from the card, one going out while the next is read
+#endif
+			uint8_t map[BLOCK_SIZE];	// delta upload, a bit per chunk the PC sends
+			uint8_t lz[LZ_WINDOW];		// and the last bytes sent: a packed chunk's window, the start being checked
+		};
+#endif
+	};
+};
+
+#define ARENA_SIZE	(sizeof(struct bridge_arena))
+
+extern struct bridge_arena arena;
+
+#else
+
+#define ARENA_SIZE	0
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARENA_H_INCLUDED */
@@ -0,0 +1,28 @@
+// 512 byte block device, what the TFT store is written against
+//
+// The SD card (sd_spi.c) is one; tools/tftstore backs one with an image
+// file so the FAT and catalogue code can be run and checked on a PC.
+
+#ifndef BLOCKDEV_H_INCLUDED
+#define BLOCKDEV_H_INCLUDED
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BLOCK_SIZE	512
+
+struct blockdev {
+	bool (*read)(void *ctx, uint32_t lba, uint8_t *buf);			// BLOCK_SIZE bytes
+	bool (*write)(void *ctx, uint32_t lba, const uint8_t *buf);
+	void *ctx;
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BLOCKDEV_H_INCLUDED */
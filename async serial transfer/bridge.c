@@ -0,0 +1,1090 @@
+// Bridge instances: one PC port, one or more LCD ports, and the find,
+// connect, wait and upload cycle main() used to run with blocking loops.
+// Each phase is now a few steps that bridge_service() moves along without
+// waiting on a port or the clock, so main() can run two bridges side by side.
+
+#include <atmel_start.h>
+#include <avr/pgmspace.h>
+#include <string.h>
+#include <bridge_config.h>
+#include "bridge.h"
+#include "dlog.h"
+#include "settings.h"
+#include "progress.h"
+#include "lathist.h"
+#include "ringplan.h"
+#include "discover.h"
+#include "store.h"
+#include "delta_proto.h"
+#include "embedded_tft.h"
+#include "tftcheck.h"
+#include "arena.h"
+#include "crc32.h"
+
+#define UPCMD_TRIES		5		// whmi-wri waits before starting again
+#define TXC_WAIT_MS		10		// longest a byte takes to leave at the slowest baud, and then some
+
+struct bridge bridges[NBRIDGES];
+
+static void connect_start(struct bridge *b);
+static void waitup_start(struct bridge *b);
+static void upload_start(struct bridge *b);
+static void upcmd_start(struct bridge *b);
+static void upload_end(struct bridge *b);
+static uint8_t upcmd_seen(void *ctx, uint8_t host, uint8_t ch);
+static bool upcmd_hold(struct bridge *b, uint8_t ch);
+static bool baudcmd_feed(struct bridge *b, uint8_t port, uint8_t ch);
+
+static bool expired(const struct bridge *b)
+{
+	return((int32_t)((uint32_t)msectime() - b->until) >= 0);
+}
+
+static void set_timer(struct bridge *b, uint16_t ms)
+{
+	b->until = (uint32_t)msectime() + ms;
+}
+
+// note the time spent in the phase we are leaving and start the next one
+static void set_phase(struct bridge *b, uint8_t phase)
+{
+	uint32_t now;
+
+	now = (uint32_t)msectime();
+	b->st.phase_ms[b->st.phase] = now - b->st.phase_start;
+	b->st.phase = phase;
+	b->st.phase_start = now;
+	b->step = 0;
+	ringplan_apply(phase, b->fan);		// hand the ring pool to this phase's traffic
+}
+
+// every display found has room for one more byte
+static bool lcds_room(const struct bridge *b)
+{
+	uint8_t port;
+
+	for (port = 0; port < NPORTS; port++)
+	{
+		if ((b->lcds.live & (1 << port)) && !ports[port].tx_ready())
+		{
+			return(false);
+		}
+	}
+	return(true);
+}
+
+// write one byte to every display found
+static void lcds_write(const struct bridge *b, uint8_t ch)
+{
+	uint8_t port;
+
+	for (port = 0; port < NPORTS; port++)
+	{
+		if (b->lcds.live & (1 << port))
+		{
+			ports[port].write(ch);
+		}
+	}
+}
+
+// put every display found back to the baud it was found at
+static void lcds_rebaud(const struct bridge *b)
+{
+	uint8_t port;
+
+	for (port = 0; port < NPORTS; port++)
+	{
+		if (b->lcds.live & (1 << port))
+		{
+			port_set_baud(port, lcd_table[port].bindex);
+		}
+	}
+}
+
+// Find the LCDs: every port in lcd_ports at once (discover.h). The
+// lowest numbered one that answers is the primary.
+static void find_start(struct bridge *b)
+{
+	set_phase(b, PH_FIND);
+	dlog0(DL_FINDING_LCD);
+	b->lcds.live = 0;
+	discover_start(b->lcd_ports);
+}
+
+// a flash is done and the displays are restarting: listen for them at
+// the baud they power up at rather than search them all again
+static void rearm_start(struct bridge *b)
+{
+	set_phase(b, PH_FIND);
+	dlog0(DL_REARM);
+	discover_rearm(b->lcd_ports, b->lcds.live);
+	b->lcds.live = 0;
+}
+
+static bool find_service(struct bridge *b)
+{
+	uint8_t port;
+	bool busy;
+
+	busy = discover_service(b->lcd_ports);
+	if (discover_pending(b->lcd_ports))
+	{
+		return(busy);
+	}
+
+	b->lcds.live = discover_found(b->lcd_ports);
+	if (b->lcds.live == 0)
+	{
+		find_start(b);		// none anywhere, go round again
+		return(true);
+	}
+	for (port = 0; !(b->lcds.live & (1 << port)); port++)
+	;
+	b->lcds.primary = port;
+	b->bindex = lcd_table[port].bindex;
+	dlog1(DL_FOUND_LCD, baud_rate(b->bindex));
+	for (port++; port < NPORTS; port++)
+	{
+		if (b->lcds.live & (1 << port))
+		{
+			dlog2(DL_FOUND_LCD_ON, port, baud_rate(lcd_table[port].bindex));
+		}
+		else if (b->lcd_ports & (1 << port))
+		{
+			dlog1(DL_NO_LCD_ON, port);
+		}
+	}
+	connect_start(b);
+	return(true);
+}
+
+// wait for connect from Nextion Editor and respond
+static void connect_start(struct bridge *b)
+{
+	set_phase(b, PH_CONNECT);
+	dlog0(DL_WAIT_EDITOR);
+	b->match = 0;
+	set_timer(b, cfg.connect_ms);
+}
+
+static bool connect_service(struct bridge *b)
+{
+	static const char discovermsg[] PROGMEM="connect\xff\xff\xff";		// expected discovery message
+	static const char nulresp[] PROGMEM={0x1a,0xff,0xff,0xff};
+	const struct port *pc = &ports[b->pc];
+	const char *sig = lcd_table[b->lcds.primary].sig;
+	uint8_t i, ch;
+	bool busy = false;
+
+	while (pc->rx_ready())
+	{
+		busy = true;
+		ch = pc->read();
+		if (pgm_read_byte(&discovermsg[b->match]) != ch)
+		{
+			b->match = 0;		// reset the search
+			continue;
+		}
+		if (++b->match < sizeof(discovermsg)-1)
+		{
+			continue;
+		}
+		// Pc has connected, now send LCD signature response
+		for (i = 0; i < 4; i++)		// send error response - might not be needed
+		{
+			pc->write(pgm_read_byte(&nulresp[i]));
+		}
+		for (i = 0; sig[i]; i++)
+		{
+			pc->write(sig[i]);		// send the saved LCD response to the Editor
+		}
+		dlog0(DL_EDITOR_CONNECTED);
+		waitup_start(b);
+		return(true);
+	}
+	if (expired(b))
+	{
+		dlog0(DL_WAIT_EDITOR);
+		set_timer(b, cfg.connect_ms);
+	}
+	return(busy);
+}
+
+// pass traffic both ways while watching the PC side for the upload command
+static void waitup_try(struct bridge *b)
+{
+#if TFT_CHECK
+	uint8_t i;
+
+	for (i = 0; i < b->held; i++)		// a whmi-wri that never ended, it goes as it came
+	{
+		lcds_write(b, b->hold[i]);
+	}
+	b->held = 0;
+#endif
+	set_timer(b, cfg.upcmd_ms);
+	b->match = 0;
+	b->dmatch = 0;
+	b->validcmd = false;
+	b->delta = false;
+	b->newbaud = 0;
+	b->filesize = 0;
+}
+
+static void waitup_start(struct bridge *b)
+{
+	set_phase(b, PH_WAITUP);
+	dlog0(DL_WAIT_UPLOAD);
+	b->tries = 0;
+	pump_init(&b->pumps[UP_LCD2PC], b->lcds.primary, b->pc, 0, NULL, b);
+	if (b->host2 != PORT_NONE)		// share the LCD until the upload
+	{
+		port_set_baud(b->host2, b->bindex);
+		arb_init(&b->arb, b->pc, b->host2, b->lcds.live, b->lcds.primary, cfg.arb_prio, upcmd_seen, b);
+	}
+	b->bmatch = 0;
+	b->bstart = true;
+	b->bhost = b->pc;
+	b->follow = -1;
+	waitup_try(b);
+}
+
+// take one PC byte; true once a whole whmi-wri command, or nexdelta's
+// dlt-wri, has gone by
+static bool upcmd_feed(struct bridge *b, uint8_t ch)
+{
+	static const char uploadmsg[] PROGMEM="whmi-wri ";		// expected upload command
+	static const char deltamsg[] PROGMEM="dlt-wri ";		// or a delta upload
+
+	if (!b->validcmd)
+	{
+		if (pgm_read_byte(&deltamsg[b->dmatch]) == ch)
+		{
+			b->delta = (++b->dmatch == sizeof(deltamsg)-1);
+		}
+		else
+		{
+			b->dmatch = 0;
+		}
+		if (pgm_read_byte(&uploadmsg[b->match]) == ch)		// compare this char with upload cmd string
+		{
+			++b->match;
+		}
+		else
+		{
+			b->match = 0;		// reset the search
+		}
+		if ((b->match == sizeof(uploadmsg)-1) || b->delta)	// all matched
+		{
+			b->validcmd = true;
+			b->commas = 0;
+			b->terms = 0;
+			b->newbaud = 0;
+			b->filesize = 0;
+			b->filecrc = 0;
+			b->dltflags = 0;
+		}
+		return(false);
+	}
+
+	// valid upload command seen - we need to get the params and find the end
+	if ((ch == 0xff) && (++b->terms == 3))
+	{
+		return(true);
+	}
+	if (ch == ',')		// comma between parameters
+	{
+		b->commas++;
+	}
+	else if ((ch >= '0') && (ch <= '9'))
+	{
+		if (b->commas == 0)		// first parameter is the file size
+		{
+			b->filesize = b->filesize * 10 + ch - '0';
+		}
+		else if (b->commas == 1)	// then the baud rate
+		{
+			b->newbaud = b->newbaud * 10 + ch - '0';
+		}
+		else if (b->commas == 2)	// dlt-wri's file CRC
+		{
+			b->filecrc = b->filecrc * 10 + ch - '0';
+		}
+		else if (b->commas == 3)	// and its flags
+		{
+			b->dltflags = b->dltflags * 10 + ch - '0';
+		}
+	}
+	return(false);
+}
+
+// take one byte from the host on port; true once a whole baud= or bauds=
+// command has gone to the displays, the rate is in bvalue
+static bool baudcmd_feed(struct bridge *b, uint8_t port, uint8_t ch)
+{
+	static const char baudmsg[] PROGMEM="baud";
+	bool start;
+
+	if (!BAUD_FOLLOW)
+	{
+		return(false);
+	}
+	if (port != b->bhost)		// the arbiter only switches hosts between commands
+	{
+		b->bhost = port;
+		b->bmatch = 0;
+		b->bstart = true;
+	}
+	start = b->bstart;
+	b->bstart = (ch == 0xff);
+	if (b->bmatch == 6)		// in the value
+	{
+		if ((ch >= '0') && (ch <= '9') && (b->bterms == 0))
+		{
+			b->bvalue = b->bvalue * 10 + ch - '0';
+			return(false);
+		}
+		if ((ch == 0xff) && (++b->bterms == 3))
+		{
+			b->bmatch = 0;
+			return(true);
+		}
+		if (ch != 0xff)
+		{
+			b->bmatch = 0;		// not a baud after all
+		}
+		return(false);
+	}
+	if ((b->bmatch < 4) && (start || b->bmatch) && (pgm_read_byte(&baudmsg[b->bmatch]) == ch))
+	{
+		b->bmatch++;		// only at the start of a command, not inside a string
+	}
+	else if ((b->bmatch == 4) && (ch == 's'))
+	{
+		b->bmatch = 5;
+	}
+	else if ((b->bmatch >= 4) && (ch == '='))
+	{
+		b->bsaved = (b->bmatch == 5);
+		b->bmatch = 6;
+		b->bvalue = 0;
+		b->bterms = 0;
+	}
+	else
+	{
+		b->bmatch = 0;
+	}
+	return(false);
+}
+
+// the displays have had "whmi-wri ": keep the rest of it from them until
+// the size has been checked (upcmd_release()); true if ch was kept
+static bool upcmd_hold(struct bridge *b, uint8_t ch)
+{
+#if TFT_CHECK
+	if (!b->validcmd || b->delta)
+	{
+		return(false);
+	}
+	if (b->held < UPCMD_HOLD)
+	{
+		b->hold[b->held] = ch;
+	}
+	if (b->held <= UPCMD_HOLD)
+	{
+		b->held++;		// one over, it didn't fit
+	}
+	return(true);
+#else
+	UNUSED(b);
+	UNUSED(ch);
+	return(false);
+#endif
+}
+
+// arbiter hook for both hosts' bytes; uploads only come from the PC
+static uint8_t upcmd_seen(void *ctx, uint8_t host, uint8_t ch)
+{
+	struct bridge *b = (struct bridge *)ctx;
+	uint8_t res;
+
+	if (host != 0)
+	{
+		return(baudcmd_feed(b, b->host2, ch) ? ARB_SEEN_STOP : 0);
+	}
+	res = upcmd_hold(b, ch) ? ARB_SEEN_KEEP : 0;
+	if (upcmd_feed(b, ch) || baudcmd_feed(b, b->pc, ch))
+	{
+		res |= ARB_SEEN_STOP;
+	}
+	return(res);
+}
+
+// the displays were told to change baud: follow once the command is out,
+// with the host that sent it
+static void follow_start(struct bridge *b)
+{
+	int8_t bindex;
+	uint8_t port;
+
+	bindex = baud_index(b->bvalue);
+	if (bindex < 0)
+	{
+		dlog1(DL_BAUD_NOFOLLOW, b->bvalue);
+		return;
+	}
+	for (port = 0; port < NPORTS; port++)
+	{
+		if ((b->lcds.live & (1 << port)) || (BAUD_FOLLOW_PC && (port == b->bhost)))
+		{
+			port_drain_start(port);
+		}
+	}
+	b->follow = bindex;
+	b->follow_until = (uint32_t)msectime() + TXC_WAIT_MS;
+}
+
+// nothing more goes either way until the last byte queued to each port
+// has left it, then they all change rate
+static bool follow_service(struct bridge *b)
+{
+	uint8_t port;
+	bool drained = true;
+
+	for (port = 0; port < NPORTS; port++)
+	{
+		if (!(b->lcds.live & (1 << port)) && !(BAUD_FOLLOW_PC && (port == b->bhost)))
+		{
+			continue;
+		}
+		if (!port_tx_empty(port))
+		{
+			b->follow_until = (uint32_t)msectime() + TXC_WAIT_MS;
+			return(false);
+		}
+		drained = drained && port_drained(port);
+	}
+	if (!drained && ((int32_t)((uint32_t)msectime() - b->follow_until) < 0))
+	{
+		return(false);		// TXC can be missed if the byte went before it was cleared
+	}
+	for (port = 0; port < NPORTS; port++)
+	{
+		if (b->lcds.live & (1 << port))
+		{
+			port_set_baud(port, b->follow);
+			lcd_table[port].bindex = b->follow;		// where an upload puts them back to
+			if (b->bsaved)
+			{
+				lcd_table[port].boot = b->follow;		// and where it restarts
+			}
+		}
+	}
+	if (BAUD_FOLLOW_PC)
+	{
+		port_set_baud(b->bhost, b->follow);
+	}
+	b->bindex = b->follow;
+	dlog1(DL_BAUD_FOLLOW, baud_rate(b->bindex));
+	b->follow = -1;
+	return(true);
+}
+
+static bool waitup_service(struct bridge *b)
+{
+	const struct port *pc = &ports[b->pc];
+	uint8_t port, ch, res;
+	bool busy;
+
+	if (b->follow >= 0)
+	{
+		return(follow_service(b));
+	}
+	busy = false;
+	for (port = 0; port < NPORTS; port++)
+	{
+		while ((port != b->lcds.primary) && (b->lcds.live & (1 << port)) && ports[port].rx_ready())
+		{
+			ports[port].read();		// the others are only drained
+			busy = true;
+		}
+	}
+
+	if (b->host2 != PORT_NONE)		// two hosts, a command at a time
+	{
+		res = arb_run(&b->arb);
+		if (res)
+		{
+			busy = true;
+		}
+		if (res & ARB_STOP)
+		{
+			if (b->validcmd && (b->arb.owner == 0))
+			{
+				upcmd_start(b);
+			}
+			else
+			{
+				follow_start(b);
+			}
+			return(true);
+		}
+		if (res & ARB_FRAME)		// the LCD is in use, don't go looking for it again
+		{
+			b->tries = 0;
+		}
+	}
+	else
+	{
+		if (pump_run(&b->pumps[UP_LCD2PC]))		// replies from the primary go to the PC
+		{
+			busy = true;
+		}
+		while (pc->rx_ready() && lcds_room(b))
+		{
+			busy = true;
+			ch = pc->read();
+			if (!upcmd_hold(b, ch))
+			{
+				lcds_write(b, ch);		// copy to the LCDs
+			}
+			if (upcmd_feed(b, ch))
+			{
+				upcmd_start(b);
+				return(true);
+			}
+			if (baudcmd_feed(b, b->pc, ch))
+			{
+				follow_start(b);
+				return(true);
+			}
+		}
+	}
+
+	if (expired(b))
+	{
+		if ((b->newbaud > 0) && !b->delta)			// timed out part way, go with what we have
+		{
+			upcmd_start(b);
+		}
+		else if (++b->tries == UPCMD_TRIES)		// timeout waiting for upload
+		{
+			port_set_baud(b->pc, b->bindex);
+			dlog0(DL_UPLOAD_TIMEOUT);
+			find_start(b);
+		}
+		else
+		{
+			waitup_try(b);
+		}
+		return(true);
+	}
+	return(busy);
+}
+
+// upload loop byte hooks, called by the pumps for every byte they move
+static void pc2lcd_seen(void *ctx, uint8_t ch)
+{
+	struct bridge_status *s = &((struct bridge *)ctx)->st;
+
+	if (s->bridge == 0)
+	{
+		store_capture_put(ch);		// copy to the SD card as it goes by
+	}
+	s->up_sent++;
+	s->up_crc = crc32_update(s->up_crc, ch);
+	if (((s->up_sent & (NEX_CHUNK - 1)) == 0) || (s->up_sent == s->up_total))
+	{
+		progress_chunk_sent(s);		// end of a chunk, time the ack
+	}
+}
+
+static void lcd2pc_seen(void *ctx, uint8_t ch)
+{
+	if (ch == NEX_ACK)		// LCD wants the next chunk
+	{
+		progress_ack(&((struct bridge *)ctx)->st);
+	}
+}
+
+#if TFT_CHECK
+// the file against every display in the upload, with n bytes of its start
+// or none; false (and logged) if one of them can't take it
+static bool tft_fits(const struct bridge *b, const uint8_t *head, uint16_t n)
+{
+	struct lcd_info info;
+	uint8_t port, why;
+
+	for (port = 0; port < NPORTS; port++)
+	{
+		if (b->lcds.live & (1 << port))
+		{
+			lcd_info(lcd_table[port].sig, &info);
+			why = tft_check(&info, b->filesize, head, n);
+			if (why != TC_OK)
+			{
+				dlog1((why == TC_SIZE) ? DL_TFT_BIG : DL_TFT_MODEL, port);
+				return(false);
+			}
+		}
+	}
+	return(true);
+}
+#endif
+
+// the PC has sent the upload command: change the baud rates and start the
+// transfer; with more than one display found it is broadcast (fanout.h)
+static void upload_start(struct bridge *b)
+{
+	int8_t bindex;
+	uint8_t port;
+
+	b->fan = (b->lcds.live & (b->lcds.live - 1)) != 0;		// before the rings are laid out for it
+	set_phase(b, PH_UPLOAD);
+	b->st.up_total = b->filesize;
+	b->st.up_crc = CRC32_INIT;
+	progress_start(&b->st, b->filesize, b->newbaud);
+	dlog1(DL_UPLOAD_START, b->newbaud);
+	if (b->st.bridge == 0)		// the store's buffers are in bridge 0's arena
+	{
+		store_capture_begin(lcd_table[b->lcds.primary].sig, b->filesize, -1);
+	}
+
+	bindex = baud_index(b->newbaud);
+	if (bindex < 0)
+	{
+		bindex = b->bindex;		// not a rate we have, stay where we are
+	}
+	port_set_baud(b->pc, bindex);		// set the PC baud rate
+	for (port = 0; port < NPORTS; port++)
+	{
+		if (b->lcds.live & (1 << port))
+		{
+			port_set_baud(port, bindex);	// set the LCD baud rates
+		}
+	}
+
+	// LCD to PC carries the acks the Editor is waiting on, so it goes
+	// first and has no burst limit; PC to LCD yields every UP_BURST bytes
+	if (b->fan)
+	{
+		dlog1(DL_FAN_START, b->lcds.live);
+		fanout_init(&b->fanout, b->pc, b->lcds.live, UP_BURST, pc2lcd_seen, lcd2pc_seen, b);
+	}
+	pump_init(&b->pumps[UP_LCD2PC], b->lcds.primary, b->pc, 0, lcd2pc_seen, b);
+	pump_init(&b->pumps[UP_PC2LCD], b->pc, b->lcds.primary, UP_BURST, pc2lcd_seen, b);
+
+	b->started = false;
+	b->ending = false;
+	b->last = (uint32_t)msectime();
+	if (b->pc == PORT_PC)
+	{
+		lat_enable(true);		// time the bridged bytes from here on
+	}
+
+	b->head_len = 0;
+#if TFT_CHECK
+	if (b->st.bridge == 0)		// the header is held in bridge 0's arena
+	{
+		b->head_len = (b->filesize < TFT_HEAD_LEN) ? b->filesize : TFT_HEAD_LEN;
+		b->head_in = 0;
+		b->head_out = 0;
+		b->refused = false;
+	}
+#endif
+}
+
+// flash the primary display with no PC: the newest stored image for its
+// model, else the one in flash; or the one asked for if it is for that model
+static void replay_begin(struct bridge *b, int8_t slot)
+{
+	slot = replay_pick(lcd_table[b->lcds.primary].sig, slot);
+	if (slot < 0)
+	{
+		dlog0(DL_REPLAY_NOFIT);
+		return;
+	}
+	b->fan = false;		// only the primary display
+	set_phase(b, PH_UPLOAD);
+	b->replaying = replay_start(&b->replay, b->lcds.primary, b->bindex, slot, &b->st);
+	if (!b->replaying)
+	{
+		find_start(b);
+	}
+}
+
+// nexdelta's dlt-wri: flash the primary display from its stored image,
+// with only the chunks that changed coming from the PC (delta_proto.h)
+static void delta_begin(struct bridge *b)
+{
+	if (b->st.bridge != 0)		// the store's buffers are in bridge 0's arena
+	{
+		ports[b->pc].write(DLT_NOBASE);
+	}
+	else if (replay_delta(&b->replay, b->lcds.primary, b->bindex, b->pc, lcd_table[b->lcds.primary].sig,
+			b->filesize, b->newbaud, b->filecrc, b->dltflags, &b->st))
+	{
+		b->fan = false;		// only the primary display
+		set_phase(b, PH_UPLOAD);
+		b->replaying = true;
+		return;
+	}
+	waitup_try(b);		// the PC sends it all with whmi-wri instead
+}
+
+#if TFT_CHECK
+// an invalid instruction for the Editor in place of the 0x05 it waits on
+static void upload_refuse(const struct bridge *b)
+{
+	static const uint8_t refused[] PROGMEM = {0x00, 0xff, 0xff, 0xff};
+	uint8_t i;
+
+	for (i = 0; i < sizeof refused; i++)
+	{
+		ports[b->pc].write(pgm_read_byte(&refused[i]));
+	}
+}
+#endif
+
+// whmi-wri is in, or as much of it as is coming: the displays get the
+// rest of it if the file fits every one of them. If not the command is
+// ended there, so they throw it away, and the PC is refused. False if so
+static bool upcmd_release(struct bridge *b)
+{
+#if TFT_CHECK
+	uint8_t i;
+
+	if ((b->held > UPCMD_HOLD) || !tft_fits(b, NULL, 0))		// too long to be one either
+	{
+		for (i = 0; i < 3; i++)
+		{
+			lcds_write(b, 0xff);
+		}
+		upload_refuse(b);
+		b->held = 0;
+		return(false);
+	}
+	for (i = 0; i < b->held; i++)
+	{
+		lcds_write(b, b->hold[i]);
+	}
+	b->held = 0;
+#else
+	UNUSED(b);
+#endif
+	return(true);
+}
+
+// the whole upload command is in
+static void upcmd_start(struct bridge *b)
+{
+	if (b->delta)
+	{
+		delta_begin(b);
+	}
+	else if (upcmd_release(b))
+	{
+		upload_start(b);
+	}
+	else
+	{
+		waitup_try(b);		// still the Editor's to try again
+	}
+}
+
+static bool replay_service(struct bridge *b)
+{
+	uint8_t res;
+
+	while ((b->replay.pc == PORT_NONE) && ports[b->pc].rx_ready())
+	{
+		ports[b->pc].read();		// the PC has no part in this one
+	}
+	res = replay_run(&b->replay);
+	if ((res == RP_DONE) || (res == RP_FAILED))
+	{
+		if (res == RP_DONE)
+		{
+			progress_end(&b->st);
+			if (b->replay.far)
+			{
+				embedded_tft_flashed();		// not again at the next boot
+			}
+		}
+		b->replaying = false;
+		lcds_rebaud(b);
+		if (res == RP_DONE)
+		{
+			rearm_start(b);		// it restarts once flashed
+		}
+		else
+		{
+			find_start(b);
+		}
+		return(true);
+	}
+	return(res == RP_BUSY);
+}
+
+// what went to the display: its CRC and size, and whether that is what
+// the shell was told to expect
+static void upload_verify(struct bridge *b)
+{
+	uint32_t crc = crc32_final(b->st.up_crc);
+
+	dlog2(DL_UP_CRC, crc, b->st.up_sent);
+	if (b->expecting)
+	{
+		dlog3(DL_UP_EXPECT, b->expect_crc, b->expect_size,
+				(crc == b->expect_crc) && (b->st.up_sent == b->expect_size));
+		b->expecting = false;		// one upload's worth
+	}
+}
+
+// the upload is over, or given up on: put every baud back
+static void upload_end(struct bridge *b)
+{
+	if (b->pc == PORT_PC)
+	{
+		lat_enable(false);
+	}
+	if (b->fan)
+	{
+		b->lcds.failed = b->fanout.failed;
+		dlog2(DL_FAN_DONE, b->fanout.live, b->fanout.failed);
+	}
+	if (b->started)
+	{
+		progress_end(&b->st);
+		upload_verify(b);
+	}
+	if (b->st.bridge == 0)
+	{
+		store_capture_end();		// catalogued if it all arrived
+	}
+	port_set_baud(b->pc, b->bindex);	// reset the PC baud rate
+	lcds_rebaud(b);					// and each LCD's
+}
+
+#if TFT_CHECK
+// the start of the file is kept from the displays until it has been
+// checked against them, then sent on ahead of the rest
+static bool head_service(struct bridge *b)
+{
+	const struct port *pc = &ports[b->pc];
+	uint8_t *head = arena.head;
+	bool busy;
+
+	busy = (b->fan ? fanout_up(&b->fanout) : pump_run(&b->pumps[UP_LCD2PC])) != 0;	// acks still go to the PC
+	if (b->refused)
+	{
+		while (pc->rx_ready())
+		{
+			pc->read();		// the Editor sends on until it sees the refusal
+			b->last = (uint32_t)msectime();
+			busy = true;
+		}
+	}
+	else if (b->head_in < b->head_len)
+	{
+		while ((b->head_in < b->head_len) && pc->rx_ready())
+		{
+			head[b->head_in++] = pc->read();
+			b->last = (uint32_t)msectime();
+			b->started = true;
+			busy = true;
+		}
+		if ((b->head_in == b->head_len) && !tft_fits(b, head, b->head_len))
+		{
+			upload_refuse(b);		// not a byte of it has reached a display
+			b->refused = true;
+		}
+	}
+	else
+	{
+		while ((b->head_out < b->head_len) && lcds_room(b))
+		{
+			lcds_write(b, head[b->head_out]);
+			pc2lcd_seen(b, head[b->head_out++]);
+			busy = true;
+		}
+		if (b->head_out == b->head_len)
+		{
+			b->head_len = 0;		// the pumps take it from here
+		}
+	}
+	if ((uint32_t)msectime() - b->last > cfg.idle_ms)		// or quiet once refused
+	{
+		upload_end(b);
+		if (!b->refused)
+		{
+			dlog0(DL_UPLOAD_TIMEOUT);
+		}
+		find_start(b);
+		return(true);
+	}
+	return(busy);
+}
+#endif
+
+static bool upload_service(struct bridge *b)
+{
+	uint8_t busy, moved;
+
+	if (b->replaying)
+	{
+		return(replay_service(b));
+	}
+#if TFT_CHECK
+	if (b->head_len)
+	{
+		return(head_service(b));
+	}
+#endif
+
+	if (b->fan)
+	{
+		busy = fanout_up(&b->fanout);
+		moved = fanout_down(&b->fanout);
+		fanout_check(&b->fanout);
+	}
+	else
+	{
+		busy = pump_run(&b->pumps[UP_LCD2PC]);
+		moved = pump_run(&b->pumps[UP_PC2LCD]);
+	}
+	if (moved)
+	{
+		b->last = (uint32_t)msectime();
+		b->started = true;
+		return(true);
+	}
+
+	// all of it sent and the last chunk acked: the displays restart now, so
+	// once that ack is out to the PC there's no need to wait for it to go quiet
+	if (!b->ending && b->st.up_total && (b->st.up_sent >= b->st.up_total) && !b->st.chunk_pending)
+	{
+		b->ending = true;
+		port_drain_start(b->pc);
+		set_timer(b, TXC_WAIT_MS);
+	}
+	if (b->ending)
+	{
+		if (!port_tx_empty(b->pc))
+		{
+			set_timer(b, TXC_WAIT_MS);
+			return(busy != 0);
+		}
+		if (port_drained(b->pc) || expired(b))
+		{
+			upload_end(b);
+			rearm_start(b);
+			return(true);
+		}
+	}
+
+	// over when the PC goes quiet, or every display dropped out
+	if (((uint32_t)msectime() - b->last > cfg.idle_ms) || (b->fan && (b->fanout.live == 0)))
+	{
+		upload_end(b);
+		dlog0(DL_UPLOAD_TIMEOUT);
+		find_start(b);
+		return(true);
+	}
+	return(busy != 0);
+}
+
+static void bridge_init(struct bridge *b, uint8_t id, uint8_t pc, uint8_t lcd_ports)
+{
+	memset(b, 0, sizeof *b);
+	b->st.bridge = id;
+	b->pc = pc;
+	b->host2 = PORT_NONE;
+	b->lcd_ports = lcd_ports;
+	dlog_tag(BRIDGE_TAG(id));
+	find_start(b);
+	dlog_tag(0);
+}
+
+// Bridge 0 is always the PC on USART0 to the displays in cfg.lcd_ports.
+// BRIDGE_DUAL adds bridge 1 on USART1 and USART3, taking them away from
+// bridge 0 and from the debug port. Otherwise cfg.host2 may name a USART
+// for a second host to share bridge 0's displays between uploads.
+void bridges_init(void)
+{
+	uint8_t lcd_ports, used, host2;
+
+	progress_init();
+	lcd_ports = cfg.lcd_ports;
+	used = 1 << PORT_PC;
+	if (NBRIDGES > 1)
+	{
+		used |= (1 << PORT_PC2) | (1 << PORT_LCD2);
+		lcd_ports &= ~used;
+		ringplan_dual();		// one fixed layout, the bridges are in different phases
+	}
+	if (lcd_ports == 0)
+	{
+		lcd_ports = 1 << PORT_LCD;
+	}
+	used |= lcd_ports;
+	host2 = PORT_NONE;
+	if ((NBRIDGES == 1) && (cfg.host2 < NPORTS) && !(used & (1 << cfg.host2)))
+	{
+		host2 = cfg.host2;
+		used |= 1 << host2;
+	}
+
+	debug_port = PORT_NONE;
+	if ((cfg.debug_port < NPORTS) && !(used & (1 << cfg.debug_port)))
+	{
+		debug_port = cfg.debug_port;
+		if (debug_port != PORT_DEBUG)
+		{
+			port_set_baud(debug_port, baud_index(9600));
+		}
+	}
+
+	bridge_init(&bridges[0], 0, PORT_PC, lcd_ports);
+	bridges[0].host2 = host2;
+#if BRIDGE_DUAL
+	bridge_init(&bridges[1], 1, PORT_PC2, 1 << PORT_LCD2);
+#endif
+}
+
+bool bridge_service(struct bridge *b)
+{
+	bool busy;
+	int8_t slot;
+
+	dlog_tag(BRIDGE_TAG(b->st.bridge));
+	if ((b->st.bridge == 0) && ((b->st.phase == PH_CONNECT) || (b->st.phase == PH_WAITUP)) &&
+			replay_requested(&slot))		// a display is found and not being uploaded to
+	{
+		replay_begin(b, slot);
+	}
+	if ((b->host2 != PORT_NONE) && (b->st.phase != PH_WAITUP))
+	{
+		while (ports[b->host2].rx_ready())
+		{
+			ports[b->host2].read();		// the LCD is not shared now
+		}
+	}
+	switch (b->st.phase)
+	{
+	case PH_FIND:
+		busy = find_service(b);
+		break;
+	case PH_CONNECT:
+		busy = connect_service(b);
+		break;
+	case PH_WAITUP:
+		busy = waitup_service(b);
+		break;
+	default:
+		busy = upload_service(b);
+		break;
+	}
+	dlog_tag(0);
+	return(busy);
+}
@@ -0,0 +1,134 @@
+// Bridge state shared between main.c, bridge.c and the reporting modules
+
+#ifndef BRIDGE_H_INCLUDED
+#define BRIDGE_H_INCLUDED
+
+#include <compiler.h>
+#include <bridge_config.h>
+#include "ports.h"
+#include "pump.h"
+#include "fanout.h"
+#include "arbiter.h"
+#include "replay.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// bridge phases, in the order each bridge steps through them
+enum bridge_phase {
+	PH_FIND,		// scanning bauds for the LCD
+	PH_CONNECT,		// waiting for the Nextion Editor to connect
+	PH_WAITUP,		// passing traffic, waiting for whmi-wri
+	PH_UPLOAD,		// forwarding the TFT file
+	PH_NPHASES
+};
+
+struct bridge_status {
+	uint8_t bridge;					// which one, index into bridges[]
+	uint8_t phase;					// current enum bridge_phase
+	uint32_t phase_start;			// msectime() when it started
+	uint32_t phase_ms[PH_NPHASES];	// how long the last run of each phase took
+	uint32_t up_total;				// file size from whmi-wri, 0 if unknown
+	uint32_t up_sent;				// bytes forwarded to the LCD this upload
+	uint32_t up_crc;				// running CRC-32 of them (crc32.h)
+	uint16_t up_acks;				// 0x05 acks seen from the LCD this upload
+	uint32_t up_baud;				// upload line rate
+	uint32_t up_start;				// msectime() the upload started
+	uint32_t up_last;				// msectime() of the last progress report
+	uint32_t chunk_end;				// msectime() the current chunk finished going out
+	bool chunk_pending;				// waiting for the LCD to ack that chunk
+	uint16_t ack_min, ack_max;		// ack latency in ms
+	uint32_t ack_sum;
+	uint16_t ack_n;
+};
+
+// displays found by the PH_FIND phase, their bauds and replies are in
+// lcd_table (discover.h)
+struct lcd_set {
+	uint8_t live;					// bit per port a display answered on
+	uint8_t primary;				// the one whose signature the Editor gets
+	uint8_t failed;					// dropped during the last broadcast upload
+};
+
+// the two directions of the upload loop, see pump.h
+enum { UP_LCD2PC, UP_PC2LCD, UP_NPUMPS };
+
+#define UPCMD_HOLD	32				// whmi-wri parameters and terminator, the Editor sends about 20
+
+// One PC to LCD bridge. Every phase is a set of steps that bridge_service()
+// moves along without waiting, so more than one can run at once.
+struct bridge {
+	uint8_t pc;						// port the Editor is on
+	uint8_t host2;					// a second host sharing the LCD outside uploads, or PORT_NONE
+	uint8_t lcd_ports;				// ports a display may be on, bit per port
+	uint8_t step;					// where in the phase, see bridge.c
+	uint32_t until;					// msectime() the current step gives up
+	struct bridge_status st;
+	struct lcd_set lcds;
+
+	// PH_CONNECT and PH_WAITUP
+	uint8_t match;					// bytes of connect or whmi-wri matched
+	uint8_t dmatch;					// and of dlt-wri, a delta upload (delta_proto.h)
+	uint8_t tries;					// whmi-wri waits so far
+	bool validcmd;					// whmi-wri or dlt-wri seen, reading its parameters
+	bool delta;						// it was dlt-wri
+	uint8_t commas, terms;
+	uint32_t newbaud, filesize;
+	uint32_t filecrc;				// dlt-wri's third parameter
+	uint8_t dltflags;				// and its fourth
+#if TFT_CHECK
+	uint8_t hold[UPCMD_HOLD];		// whmi-wri's parameters, kept from the displays until its size is checked
+	uint8_t held;
+#endif
+	uint8_t bindex;					// baud the primary display was found at, or moved to
+	struct arbiter arb;				// PH_WAITUP with host2
+
+	// PH_WAITUP baud= and bauds= (BAUD_FOLLOW)
+	uint8_t bmatch, bterms;			// bytes of the command matched, 0xff bytes after its value
+	bool bstart;					// the last PC byte could have ended a command
+	bool bsaved;					// it was bauds=, which the display keeps over a restart
+	uint8_t bhost;					// port the command is coming from, which follows too
+	uint32_t bvalue;
+	int8_t follow;					// baud index being moved to, -1 for none
+	uint32_t follow_until;			// msectime() to stop waiting on TXC
+
+	// PH_UPLOAD
+	bool fan;						// more than one display, broadcast
+	bool started;					// the PC has sent file data
+	uint32_t last;					// msectime() of the last PC byte
+	struct pump pumps[UP_NPUMPS];
+	struct fanout fanout;
+	bool replaying;					// flashing from the SD card, or a delta (bridge 0)
+	bool ending;					// all sent and acked, the last ack still going to the PC
+	uint16_t head_len;				// file bytes held back for the header check, 0 once through
+	uint16_t head_in, head_out;		// of those read from the PC, and sent on
+	bool refused;					// they failed it, the rest of the file is thrown away
+	bool expecting;					// the shell's expect: what the next upload should come to
+	uint32_t expect_crc, expect_size;
+	struct replay replay;
+};
+
+#define NBRIDGES	(BRIDGE_DUAL ? 2 : 1)
+
+extern struct bridge bridges[NBRIDGES];
+
+// dlog_tag() for a bridge's lines, none when there is only one
+#define BRIDGE_TAG(i)	((NBRIDGES > 1) ? (i) + 1 : 0)
+
+void bridges_init(void);			// from the settings, once at reset
+bool bridge_service(struct bridge *b);	// false when it had nothing to do
+
+#define NBAUDS 8				// entries in the baud tables
+
+uint64_t msectime(void);
+uint32_t baud_rate(uint8_t bindex);		// baud for a table index
+uint16_t baud_ubrr(uint8_t bindex);		// divisor for that index
+bool baud_u2x(uint8_t bindex);			// that divisor is for double speed
+int8_t baud_index(uint32_t baud);		// table index for a baud, -1 if none
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BRIDGE_H_INCLUDED */
@@ -0,0 +1,102 @@
+// CPU load meter, see cpuload.h
+
+#include <atmel_start.h>
+#include <string.h>
+#include <atomic.h>
+#include "bridge.h"
+#include "cpuload.h"
+#include "isrprof.h"
+#include "timebase.h"
+
+#if CPU_LOAD
+
+uint32_t cpu_loops;
+
+static uint32_t cpu_idle;			// idle cycles this second
+static uint16_t pass_t0;			// timer 5 at the top of the pass
+static uint16_t pass_isr0;			// low half of isr_cycles then
+
+static uint32_t win_start;			// msectime() the second started
+static uint32_t win_isr0;			// isr_cycles then
+static struct cpu_load last;
+
+static uint16_t isr_cycles_lo(void)
+{
+	uint16_t c;
+
+	ENTER_CRITICAL(R);
+	c = (uint16_t)isr_cycles;
+	EXIT_CRITICAL(R);
+	return(c);
+}
+
+void cpu_pass_begin(void)
+{
+	pass_t0 = tcnt5();
+	pass_isr0 = isr_cycles_lo();
+}
+
+// a pass is far shorter than the 4mS timer 5 wraps in, so 16 bits will do
+void cpu_pass_idle(void)
+{
+	uint16_t span, isr;
+
+	span = tcnt5() - pass_t0;
+	isr = isr_cycles_lo() - pass_isr0;
+	if (span > isr)
+	{
+		cpu_idle += span - isr;
+	}
+}
+
+void cpuload_service(void)
+{
+	uint32_t now, ms, win, isr;
+
+	now = (uint32_t)msectime();
+	ms = now - win_start;
+	if (ms < 1000)
+	{
+		return;
+	}
+	ENTER_CRITICAL(R);
+	isr = isr_cycles;
+	EXIT_CRITICAL(R);
+
+	win = ms * (F_CPU / 1000);
+	if (ms > 100000)		// not serviced for ages, e.g. blocked in a wait
+	{
+		win = 0;
+	}
+	if (win)
+	{
+		last.isr_pct = (isr - win_isr0) / (win / 100);
+		last.idle_pct = cpu_idle / (win / 100);
+		last.work_pct = (last.isr_pct + last.idle_pct < 100) ? 100 - last.isr_pct - last.idle_pct : 0;
+		last.loops = cpu_loops * 1000 / ms;
+	}
+	win_start = now;
+	win_isr0 = isr;
+	cpu_idle = 0;
+	cpu_loops = 0;
+}
+
+bool cpuload_get(struct cpu_load *l)
+{
+	*l = last;
+	return(true);
+}
+
+#else
+
+void cpuload_service(void)
+{
+}
+
+bool cpuload_get(struct cpu_load *l)
+{
+	memset(l, 0, sizeof *l);
+	return(false);
+}
+
+#endif
@@ -0,0 +1,46 @@
+// CPU load meter: share of each second spent in ISRs, in work and idle
+// ISR time comes from the isrprof.h hooks. Idle time is the polling passes
+// that found nothing to do, marked with cpu_pass_begin()/cpu_pass_idle().
+// Everything else, including the idle-time services, counts as work.
+
+#ifndef CPULOAD_H_INCLUDED
+#define CPULOAD_H_INCLUDED
+
+#include <compiler.h>
+#include <bridge_config.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct cpu_load {
+	uint8_t isr_pct;
+	uint8_t work_pct;
+	uint8_t idle_pct;
+	uint32_t loops;			// main loop passes in the last second
+};
+
+#if CPU_LOAD
+
+extern uint32_t cpu_loops;
+
+void cpu_pass_begin(void);	// top of a polling pass
+void cpu_pass_idle(void);	// the pass found nothing to do
+#define cpu_loop()		(cpu_loops++)
+
+#else
+
+#define cpu_pass_begin()
+#define cpu_pass_idle()
+#define cpu_loop()
+
+#endif
+
+void cpuload_service(void);		// idle-time: close off each second
+bool cpuload_get(struct cpu_load *l);	// last full second, false if not built in
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CPULOAD_H_INCLUDED */
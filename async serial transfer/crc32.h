@@ -0,0 +1,24 @@
+// CRC-32 (IEEE 802.3, the zip one) of stored TFT images
+//
+// Start from CRC32_INIT, feed bytes, and finish with crc32_final().
+
+#ifndef CRC32_H_INCLUDED
+#define CRC32_H_INCLUDED
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CRC32_INIT	0xffffffffUL
+
+uint32_t crc32_update(uint32_t crc, uint8_t ch);
+uint32_t crc32_block(uint32_t crc, const uint8_t *p, uint16_t n);
+uint32_t crc32_final(uint32_t crc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CRC32_H_INCLUDED */
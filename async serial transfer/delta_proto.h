@@ -0,0 +1,76 @@
+// Delta and packed upload protocol, shared by the firmware and tools/nexdelta
+//
+// With an earlier image for the display on the SD card (TFT_STORE), only
+// the 4096 byte chunks that changed need cross the PC link, and those can
+// come packed (PACKED_UPLOAD), with or without a card. In PH_WAITUP,
+// where the Editor would send whmi-wri, the PC sends
+//
+//     dlt-wri <size>,<baud>,<crc>,<flags> ff ff ff
+//
+// size of the new file, baud for the display (0 for the fastest it takes),
+// the CRC-32 of the whole file and DLT_xxx flags, all in decimal. The
+// bridge answers a single byte:
+//
+//     DLT_NOBASE    no stored image for this display to work from; send it
+//                   all with whmi-wri instead. Never for DLT_PACKED, which
+//                   goes on with an empty base and every chunk changed
+//     DLT_HELLO     u16 chunks in the stored image, then the PC sends a
+//                   u32 CRC-32 of each chunk of the new file, in order
+//
+// or DLT_END (below) with DLT_TOOBIG when the file is bigger than the
+// display's flash.
+//
+// The bridge then flashes the display itself, taking unchanged chunks from
+// the card and asking for each changed one as it gets to it:
+//
+//     DLT_WANT      u16 chunk; the PC sends it, 4096 bytes (the last one
+//                   to the end of the file)
+//     DLT_END       u8 DLT_OK or a DLT_xxx failure, u16 chunks the PC sent
+//
+// With DLT_PACKED the PC answers DLT_WANT with a u16 packed length, 0 for
+// a chunk sent as it is, then that many bytes of LZSS (lzss.h) whose window
+// is the file's 256 bytes before the chunk. Packed data expands as it goes
+// out, so it is paced: after the length the PC sends at most
+// DLT_CREDITS * DLT_CREDIT bytes of the chunk, and DLT_CREDIT more for
+// each DLT_MORE.
+//
+// The start of the file is made before any of it goes to the display, and
+// a model named in its header that isn't the display's ends the upload
+// there with DLT_MODEL.
+//
+// The bridge keeps what it flashed as the display's newest stored image,
+// the base for the next delta. All numbers are little endian. The reply
+// bytes are none of Nextion's return codes, so the PC can pick them out of
+// anything the display said before the bridge took over. Unpacked, the PC
+// link must be no faster than the display's: a wanted chunk arrives in one go.
+
+#ifndef DELTA_PROTO_H_INCLUDED
+#define DELTA_PROTO_H_INCLUDED
+
+#define DLT_CHUNK		4096
+#define DLT_MAX_CHUNKS	4096		// 16 MB, a bit each in the bridge's map
+
+#define DLT_NOBASE		'N'
+#define DLT_HELLO		'H'
+#define DLT_WANT		'R'
+#define DLT_MORE		'M'
+#define DLT_END			'E'
+
+// dlt-wri flags
+#define DLT_PACKED		1			// changed chunks come LZSS packed
+
+#define DLT_CREDIT		128			// bytes per DLT_MORE
+#define DLT_CREDITS		3			// sent ahead of the first
+
+// DLT_END status
+#define DLT_OK			0
+#define DLT_NOACK		1			// the display stopped acking chunks
+#define DLT_READ		2			// the stored image couldn't be read
+#define DLT_NOBAUD		3			// the display took no baud
+#define DLT_PCQUIET		4			// the PC stopped sending
+#define DLT_BADCRC		5			// all sent, but not the file the PC meant
+#define DLT_BADPACK		6			// a packed chunk didn't come out to its length
+#define DLT_TOOBIG		7			// bigger than the display's flash, nothing sent
+#define DLT_MODEL		8			// made for another model, nothing sent
+
+#endif /* DELTA_PROTO_H_INCLUDED */
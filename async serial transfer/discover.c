@@ -0,0 +1,302 @@
+// Parallel LCD discovery, see discover.h
+// Nothing here waits: a port that is settling or listening just returns
+// and lets the next one have its turn.
+
+#include <atmel_start.h>
+#include <avr/pgmspace.h>
+#include <string.h>
+#include <bridge_config.h>
+#include "bridge.h"
+#include "discover.h"
+#include "dlog.h"
+#include "settings.h"
+
+#define FIND_SETTLE_MS	2		// baud generator settling time
+#define FIND_LISTEN_MS	250		// time for a whole discovery reply
+#define REARM_READY_MS	200		// from the startup return to the ready one
+
+struct lcd_entry lcd_table[NPORTS];
+
+// probe steps
+enum { DS_DONE, DS_BAUD, DS_SETTLE, DS_LISTEN, DS_WATCH };
+
+// sig_feed() results
+enum { SIG_MORE, SIG_DONE, SIG_LONG };
+
+// boot_feed() results
+enum { BOOT_MORE, BOOT_START, BOOT_READY };
+
+static bool expired(const struct lcd_entry *e)
+{
+	return((int32_t)((uint32_t)msectime() - e->until) >= 0);
+}
+
+// take one byte of a discovery response; the reply goes in sig with its
+// prefix and terminator
+static uint8_t sig_feed(struct sig_parse *p, uint8_t ch, char *sig)
+{
+	static const char foundmsg[] PROGMEM="comok ";		// first part of expected LCD response
+
+	if (p->match < sizeof(foundmsg)-1)
+	{
+		if (pgm_read_byte(&foundmsg[p->match]) == ch)
+		{
+			p->match++;
+		}
+		else
+		{
+			p->match = (ch == 'c') ? 1 : 0;		// reset the search, this could be a new start
+		}
+		if (p->match == sizeof(foundmsg)-1)
+		{
+			p->len = p->match;
+			p->term = 0;
+			memcpy_P(sig, foundmsg, p->len);
+		}
+		return(SIG_MORE);
+	}
+	if (p->len >= LCDSIG_SIZE - 1)		// no room for it and our null terminator
+	{
+		return(SIG_LONG);
+	}
+	sig[p->len++] = ch;
+	p->term = (ch == 0xff) ? p->term + 1 : 0;
+	if (p->term == 3)		// found response terminator
+	{
+		sig[p->len] = '\0';
+		return(SIG_DONE);
+	}
+	return(SIG_MORE);
+}
+
+// take one byte from a display that is restarting: the startup return is
+// three 0x00 then the terminator, the ready one 0x88 then the terminator.
+// match counts the 0x00 bytes, 4 for 0x88
+static uint8_t boot_feed(struct sig_parse *p, uint8_t ch)
+{
+	if ((ch == 0xff) && (p->match >= 3))
+	{
+		if (++p->term < 3)
+		{
+			return(BOOT_MORE);
+		}
+		ch = p->match;
+		p->match = 0;
+		p->term = 0;
+		return((ch == 4) ? BOOT_READY : BOOT_START);
+	}
+	if (p->term)		// something else after a terminator started
+	{
+		p->match = 0;
+		p->term = 0;
+	}
+	if (ch == 0x88)
+	{
+		p->match = 4;
+	}
+	else if ((ch == 0x00) && (p->match < 3))
+	{
+		p->match++;
+	}
+	else
+	{
+		p->match = 0;
+	}
+	return(BOOT_MORE);
+}
+
+static bool probe_service(uint8_t port)
+{
+	static const char discovermsg[] PROGMEM="\x00\xff\xff\xff""connect\xff\xff\xff";	// discovery message
+	struct lcd_entry *e = &lcd_table[port];
+	const struct port *lcd = &ports[port];
+	uint8_t j, r;
+	int8_t prefer;
+	bool busy = false;
+
+	switch (e->step)
+	{
+	case DS_BAUD:		// next baud to try, the preferred one first
+		if (e->tries == NBAUDS)
+		{
+			e->step = DS_DONE;		// nothing on this port
+			return(true);
+		}
+		prefer = baud_index(cfg.lcd_baud);		// -1 if none set
+		j = e->tries;
+		if (prefer < 0)
+		{
+			e->want = j;
+		}
+		else
+		{
+			e->want = (j == 0) ? prefer : ((j <= prefer) ? j - 1 : j);
+		}
+		port_set_baud(port, e->want);	// set the LCD baud rate
+		e->until = (uint32_t)msectime() + FIND_SETTLE_MS;
+		e->step = DS_SETTLE;
+		return(true);
+
+	case DS_SETTLE:		// send discovery command to LCD
+		if (!expired(e))
+		{
+			return(false);
+		}
+		for (j = 0; j < sizeof(discovermsg)-1; j++)
+		{
+			lcd->write(pgm_read_byte(&discovermsg[j]));		// connect
+		}
+		memset(&e->sp, 0, sizeof e->sp);
+		e->until = (uint32_t)msectime() + FIND_LISTEN_MS;
+		e->step = DS_LISTEN;
+		return(true);
+
+	case DS_LISTEN:		// pick the reply out of whatever comes back
+		while (lcd->rx_ready())
+		{
+			busy = true;
+			r = sig_feed(&e->sp, lcd->read(), e->sig);
+			if (r == SIG_DONE)
+			{
+				e->bindex = e->want;
+				e->boot = e->want;
+				e->step = DS_DONE;
+				return(true);
+			}
+			if (r == SIG_LONG)
+			{
+				dlog1(DL_LCD_RESP_LONG, port);
+				e->until = (uint32_t)msectime();		// no good at this baud
+				break;
+			}
+		}
+		if (expired(e))
+		{
+			if (e->rearm)
+			{
+				e->rearm = false;		// not there after all, search from the top
+			}
+			else
+			{
+				e->tries++;
+			}
+			e->step = DS_BAUD;
+		}
+		return(busy);
+
+	case DS_WATCH:		// just flashed: wait for it to come back up
+		while (lcd->rx_ready())
+		{
+			busy = true;
+			r = boot_feed(&e->sp, lcd->read());
+			if (r == BOOT_READY)
+			{
+				e->rearm = true;
+				e->until = (uint32_t)msectime();
+				e->step = DS_SETTLE;		// probe straight away
+				return(true);
+			}
+			if (r == BOOT_START)
+			{
+				e->rearm = true;		// and the ready return should follow
+				e->until = (uint32_t)msectime() + REARM_READY_MS;
+			}
+		}
+		if (expired(e))
+		{
+			e->step = e->rearm ? DS_SETTLE : DS_BAUD;		// started but never said ready, try it anyway
+		}
+		return(busy);
+
+	default:
+		return(false);
+	}
+}
+
+void discover_start(uint8_t mask)
+{
+	uint8_t port;
+
+	for (port = 0; port < NPORTS; port++)
+	{
+		if (mask & (1 << port))
+		{
+			memset(&lcd_table[port], 0, sizeof lcd_table[port]);
+			lcd_table[port].bindex = -1;
+			lcd_table[port].boot = -1;
+			lcd_table[port].step = DS_BAUD;
+		}
+	}
+}
+
+void discover_rearm(uint8_t mask, uint8_t live)
+{
+	struct lcd_entry *e;
+	uint8_t port;
+	int8_t boot;
+
+	for (port = 0; port < NPORTS; port++)
+	{
+		if (!(mask & (1 << port)))
+		{
+			continue;
+		}
+		e = &lcd_table[port];
+		boot = e->boot;
+		memset(e, 0, sizeof *e);
+		e->bindex = -1;
+		e->boot = boot;
+		if (!(live & (1 << port)) || (boot < 0))
+		{
+			e->step = DS_DONE;		// nothing there before the flash
+			continue;
+		}
+		e->want = boot;
+		port_set_baud(port, boot);
+		e->until = (uint32_t)msectime() + REARM_WAIT_MS;
+		e->step = DS_WATCH;
+	}
+}
+
+bool discover_service(uint8_t mask)
+{
+	uint8_t port;
+	bool busy = false;
+
+	for (port = 0; port < NPORTS; port++)
+	{
+		if (mask & (1 << port))
+		{
+			busy |= probe_service(port);
+		}
+	}
+	return(busy);
+}
+
+uint8_t discover_pending(uint8_t mask)
+{
+	uint8_t port, m = 0;
+
+	for (port = 0; port < NPORTS; port++)
+	{
+		if ((mask & (1 << port)) && (lcd_table[port].step != DS_DONE))
+		{
+			m |= 1 << port;
+		}
+	}
+	return(m);
+}
+
+uint8_t discover_found(uint8_t mask)
+{
+	uint8_t port, m = 0;
+
+	for (port = 0; port < NPORTS; port++)
+	{
+		if ((mask & (1 << port)) && (lcd_table[port].bindex >= 0))
+		{
+			m |= 1 << port;
+		}
+	}
+	return(m);
+}
@@ -0,0 +1,56 @@
+// LCD discovery on several ports at once
+//
+// Each port steps through the bauds on its own, the preferred one first,
+// sending the connect probe and picking the "comok ...\xff\xff\xff" reply
+// out of whatever comes back. All ports probe in parallel, so a search
+// takes as long as the slowest port rather than the sum of them. The
+// result is lcd_table: the baud and reply for every port that answered.
+// After a flash the displays restart at the baud they power up at, so a
+// re-arm only listens there for their startup return (00 00 00 ff ff ff,
+// then 88 ff ff ff) and probes once; a display that doesn't show up in
+// time is searched for as usual.
+
+#ifndef DISCOVER_H_INCLUDED
+#define DISCOVER_H_INCLUDED
+
+#include <compiler.h>
+#include "ports.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LCDSIG_SIZE		80		// returned LCD signature string
+
+// reply being picked out of a discovery response
+struct sig_parse {
+	uint8_t match;					// bytes of "comok " matched
+	uint8_t len;					// reply bytes so far, the prefix included
+	uint8_t term;					// 0xff bytes in a row
+};
+
+struct lcd_entry {
+	int8_t bindex;					// baud table index it answered at, -1 if not (yet)
+	int8_t boot;					// the one it powers up at: found at, or set by bauds=
+	bool rearm;						// restarted, this probe is the only one before a search
+	uint8_t step;					// see discover.c, 0 when not probing
+	uint8_t tries;					// bauds tried this search
+	uint8_t want;					// the one being tried
+	uint32_t until;					// msectime() the current step gives up
+	struct sig_parse sp;
+	char sig[LCDSIG_SIZE];			// the reply, replayed to the Editor
+};
+
+extern struct lcd_entry lcd_table[NPORTS];		// by USART number
+
+void discover_start(uint8_t mask);		// start probing these ports, bit per port
+void discover_rearm(uint8_t mask, uint8_t live);	// the same once the live ones were flashed
+bool discover_service(uint8_t mask);	// false when it had nothing to do
+uint8_t discover_pending(uint8_t mask);	// ports still probing
+uint8_t discover_found(uint8_t mask);	// ports that answered
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DISCOVER_H_INCLUDED */
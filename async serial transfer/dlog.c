@@ -0,0 +1,186 @@
+// Deferred debug logger for the Nextion uploader
+// The log ring holds binary records only; nothing here ever waits on the
+// debug port. With no debug port the records are still taken off the ring.
+
+#include <atmel_start.h>
+#include <avr/pgmspace.h>
+#include <stdio.h>
+#include <atomic.h>
+#include <bridge_config.h>
+#include "dlog.h"
+#include "ports.h"
+
+#if (DLOG_RING_SIZE & (DLOG_RING_SIZE - 1)) || (DLOG_RING_SIZE > 128)
+#error DLOG_RING_SIZE must be a power of 2 no bigger than 128
+#endif
+#define DLOG_RING_MASK (DLOG_RING_SIZE - 1)
+
+// format strings live in flash, indexed by enum dlog_msg
+#define DLOG_MSG(id, fmt) static const char id##_fmt[] PROGMEM = fmt;
+#include "dlog_msgs.h"
+#undef DLOG_MSG
+
+static PGM_P const dlog_fmt[DL_NMSGS] PROGMEM = {
+#define DLOG_MSG(id, fmt) id##_fmt,
+#include "dlog_msgs.h"
+#undef DLOG_MSG
+};
+
+struct dlog_rec {
+	uint8_t id;
+	uint8_t tag;			// which bridge it is about, 0 if only one
+	long arg[DLOG_MAX_ARGS];
+};
+
+static struct dlog_rec dlog_ring[DLOG_RING_SIZE];
+static volatile uint8_t dlog_head;		// next slot to fill
+static volatile uint8_t dlog_tail;		// next slot to format
+static volatile uint16_t dlog_ndropped;	// dropped since reset
+static uint16_t dlog_nreported;			// drops already reported
+static bool dlog_muted;
+static uint8_t dlog_curtag;
+
+static char dlog_line[DLOG_LINE_SIZE];	// the line being sent
+static uint8_t dlog_lpos, dlog_llen;
+
+// queue a record; safe from any context, returns at once
+void dlog_put(uint8_t id, long a, long b, long c, long d)
+{
+	uint8_t head;
+	struct dlog_rec *r;
+
+	ENTER_CRITICAL(W);
+	head = dlog_head;
+	if (((head + 1) & DLOG_RING_MASK) == dlog_tail)		// full, count it and give up
+	{
+		dlog_ndropped++;
+		EXIT_CRITICAL(W);
+		return;
+	}
+	r = &dlog_ring[head];
+	r->id = id;
+	r->tag = dlog_curtag;
+	r->arg[0] = a;
+	r->arg[1] = b;
+	r->arg[2] = c;
+	r->arg[3] = d;
+	dlog_head = (head + 1) & DLOG_RING_MASK;
+	EXIT_CRITICAL(W);
+}
+
+// format the next record (or a drop report) into the line buffer
+static bool dlog_format(void)
+{
+	struct dlog_rec *r;
+	uint16_t dropped;
+	uint8_t id;
+	int n, pre;
+
+	ENTER_CRITICAL(R);
+	dropped = dlog_ndropped;
+	EXIT_CRITICAL(R);
+
+	if (dropped != dlog_nreported)		// tell them we lost some first
+	{
+		n = snprintf_P(dlog_line, sizeof dlog_line, (PGM_P)pgm_read_ptr(&dlog_fmt[DL_DROPPED]),
+				(long)(uint16_t)(dropped - dlog_nreported));
+		dlog_nreported = dropped;
+	}
+	else
+	{
+		for (;;)
+		{
+			if (dlog_tail == dlog_head)
+			{
+				return(false);
+			}
+			r = &dlog_ring[dlog_tail];
+			id = r->id;
+			if (id >= DL_NMSGS)
+			{
+				id = DL_DROPPED;		// should not happen, but never index off the table
+			}
+			if (!dlog_muted || (id >= DL_SHELL))
+			{
+				break;
+			}
+			dlog_tail = (dlog_tail + 1) & DLOG_RING_MASK;		// quiet mode, skip status lines
+		}
+		pre = 0;
+		if (r->tag)
+		{
+			pre = snprintf_P(dlog_line, sizeof dlog_line, PSTR("b%d "), r->tag);
+		}
+		n = pre + snprintf_P(dlog_line + pre, sizeof dlog_line - pre, (PGM_P)pgm_read_ptr(&dlog_fmt[id]),
+				r->arg[0], r->arg[1], r->arg[2], r->arg[3]);
+		dlog_tail = (dlog_tail + 1) & DLOG_RING_MASK;		// only we move the tail
+	}
+
+	if (n < 0)
+	{
+		n = 0;
+	}
+	dlog_llen = (n < (int)sizeof dlog_line) ? n : sizeof dlog_line - 1;	// truncated lines are still sent
+	dlog_lpos = 0;
+	return(true);
+}
+
+// push out what fits in the debug port's tx ring without ever waiting for it
+void dlog_service(void)
+{
+	if (debug_port == PORT_NONE)
+	{
+		while (dlog_format())		// nowhere to send them, just keep the ring moving
+		;
+		dlog_llen = 0;
+		return;
+	}
+	while (ports[debug_port].tx_ready())
+	{
+		if (dlog_lpos >= dlog_llen)
+		{
+			if (!dlog_format())
+			{
+				return;
+			}
+			continue;
+		}
+		ports[debug_port].write(dlog_line[dlog_lpos++]);
+	}
+}
+
+uint16_t dlog_dropped(void)
+{
+	uint16_t n;
+
+	ENTER_CRITICAL(R);
+	n = dlog_ndropped;
+	EXIT_CRITICAL(R);
+	return(n);
+}
+
+bool dlog_idle(void)
+{
+	return((dlog_lpos >= dlog_llen) && (dlog_tail == dlog_head) && (dlog_dropped() == dlog_nreported));
+}
+
+bool dlog_sending(void)
+{
+	return(dlog_lpos < dlog_llen);
+}
+
+uint8_t dlog_free(void)
+{
+	return((dlog_tail - dlog_head - 1) & DLOG_RING_MASK);
+}
+
+// quiet mode only drops bridge status lines, shell replies still go out
+void dlog_mute(bool on)
+{
+	dlog_muted = on;
+}
+
+void dlog_tag(uint8_t tag)
+{
+	dlog_curtag = tag;
+}
@@ -0,0 +1,44 @@
+// Deferred debug logger for the Nextion uploader
+// Call sites queue a message id plus up to 4 long args; the text is only
+// formatted and written to the debug port from dlog_service() when the
+// bridge is idle.
+
+#ifndef DLOG_H_INCLUDED
+#define DLOG_H_INCLUDED
+
+#include <compiler.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// message ids - index into the PROGMEM format table built in dlog.c
+enum dlog_msg {
+#define DLOG_MSG(id, fmt) id,
+#include "dlog_msgs.h"
+#undef DLOG_MSG
+	DL_NMSGS
+};
+
+#define DLOG_MAX_ARGS 4
+
+#define dlog0(id)				dlog_put((id), 0, 0, 0, 0)
+#define dlog1(id, a)			dlog_put((id), (long)(a), 0, 0, 0)
+#define dlog2(id, a, b)			dlog_put((id), (long)(a), (long)(b), 0, 0)
+#define dlog3(id, a, b, c)		dlog_put((id), (long)(a), (long)(b), (long)(c), 0)
+#define dlog4(id, a, b, c, d)	dlog_put((id), (long)(a), (long)(b), (long)(c), (long)(d))
+
+void dlog_put(uint8_t id, long a, long b, long c, long d);	// never blocks, drops if full
+void dlog_service(void);		// format and send at most what the debug port can take now
+bool dlog_idle(void);			// true when nothing is queued or part sent
+bool dlog_sending(void);		// a line is part way out of the door
+uint16_t dlog_dropped(void);	// total records dropped since reset
+uint8_t dlog_free(void);		// ring slots free right now
+void dlog_mute(bool on);		// quietly discard records instead of sending them
+void dlog_tag(uint8_t tag);		// prefix records queued from now on with "b<tag> ", 0 for none
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DLOG_H_INCLUDED */
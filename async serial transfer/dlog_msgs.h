@@ -0,0 +1,91 @@
+// Debug log messages: id and PROGMEM format, args are always long
+// Included twice by dlog.c and once by dlog.h, so no include guard.
+// Ids before DL_SHELL are bridge status lines and are muted by quiet mode.
+
+DLOG_MSG(DL_FINDING_LCD,		"Finding LCD\n\r")
+DLOG_MSG(DL_REARM,				"Waiting for LCD restart\n\r")
+DLOG_MSG(DL_FOUND_LCD,			"Found LCD @ %ld\n\r")
+DLOG_MSG(DL_LCD_RESP_LONG,		"LCD response too long on u%ld\n\r")
+DLOG_MSG(DL_WAIT_EDITOR,		"Waiting for Nextion Editor\n\r")
+DLOG_MSG(DL_EDITOR_CONNECTED,	"Nextion Editor connected\n\r")
+DLOG_MSG(DL_WAIT_UPLOAD,		"Waiting for upload cmd\n\r")
+DLOG_MSG(DL_UPLOAD_START,		"Starting Upload @ %ld\n\r")
+DLOG_MSG(DL_UPLOAD_TIMEOUT,		"Upload timed out, finished?\n\r")
+DLOG_MSG(DL_UP_PROGRESS,		"up %ld%% %ld of %ld bytes\n\r")
+DLOG_MSG(DL_UP_RATE,			"up %ld B/s, line %ld, eta %ld s\n\r")
+DLOG_MSG(DL_UP_ACKS,			"acks %ld min %ld avg %ld max %ld ms\n\r")
+DLOG_MSG(DL_UP_DONE,			"up done %ld bytes in %ld ms\n\r")
+DLOG_MSG(DL_UP_CRC,				"up crc %08lx of %ld bytes\n\r")
+DLOG_MSG(DL_UP_EXPECT,			"expected %08lx %ld bytes, ok %ld\n\r")
+DLOG_MSG(DL_RING_BUSY,			"rings kept, rx busy at phase %ld\n\r")
+DLOG_MSG(DL_FOUND_LCD_ON,		"Found LCD on u%ld @ %ld\n\r")
+DLOG_MSG(DL_NO_LCD_ON,			"No LCD on u%ld\n\r")
+DLOG_MSG(DL_STORE_UP,			"SD store, %ld images\n\r")
+DLOG_MSG(DL_STORE_NONE,			"No SD store\n\r")
+DLOG_MSG(DL_STORE_CAPTURE,		"Copying upload to SD slot %ld\n\r")
+DLOG_MSG(DL_STORE_SAVED,		"Stored slot %ld %ld bytes crc %08lx\n\r")
+DLOG_MSG(DL_STORE_DROPPED,		"SD copy dropped after %ld bytes\n\r")
+DLOG_MSG(DL_REPLAY_START,		"Flashing slot %ld (-2 rom), %ld bytes\n\r")
+DLOG_MSG(DL_REPLAY_NOFIT,		"No stored image for this LCD\n\r")
+DLOG_MSG(DL_REPLAY_BAUD,		"LCD took %ld baud\n\r")
+DLOG_MSG(DL_REPLAY_NOBAUD,		"LCD didn't take %ld baud\n\r")
+DLOG_MSG(DL_REPLAY_FAIL,		"Flash failed after %ld bytes, why %ld\n\r")
+DLOG_MSG(DL_REPLAY_DONE,		"Flash done, crc ok %ld\n\r")
+DLOG_MSG(DL_DELTA_START,		"Delta upload on slot %ld, %ld chunks\n\r")
+DLOG_MSG(DL_DELTA_NOBASE,		"No stored image to delta from\n\r")
+DLOG_MSG(DL_DELTA_SUMS,			"Delta %ld of %ld chunks changed\n\r")
+DLOG_MSG(DL_BAUD_FOLLOW,		"Display moved to %ld baud\n\r")
+DLOG_MSG(DL_BAUD_NOFOLLOW,		"Display sent to %ld baud, no such rate\n\r")
+DLOG_MSG(DL_ARB_CUT,			"host u%ld quiet mid command, cuts %ld\n\r")
+DLOG_MSG(DL_FAN_START,			"Broadcast to lcds %ld\n\r")
+DLOG_MSG(DL_FAN_STALL,			"lcd u%ld stalled at %ld, dropped\n\r")
+DLOG_MSG(DL_FAN_NOACK,			"lcd u%ld no ack at %ld, dropped\n\r")
+DLOG_MSG(DL_FAN_DONE,			"Broadcast done, lcds ok %ld failed %ld\n\r")
+DLOG_MSG(DL_TFT_BIG,			"lcd u%ld: file bigger than its flash\n\r")
+DLOG_MSG(DL_TFT_MODEL,			"lcd u%ld: file made for another model\n\r")
+
+// replies to debug shell commands
+DLOG_MSG(DL_SHELL,				"?: try help\n\r")
+DLOG_MSG(DL_SH_HELP1,			"stats clear times up show save load defaults\n\r")
+DLOG_MSG(DL_SH_HELP2,			"set baud|connect|upcmd|idle|report <n>\n\r")
+DLOG_MSG(DL_SH_HELP3,			"set mode|lcds|debug|host2|prio <n>\n\r")
+DLOG_MSG(DL_SH_HELP4,			"selftest bench hist prof cpu mem pumps\n\r")
+DLOG_MSG(DL_SH_HELP5,			"lcds rate arb store flash [slot|rom]\n\r")
+DLOG_MSG(DL_SH_HELP6,			"expect <crc hex> <bytes>, none to cancel\n\r")
+DLOG_MSG(DL_SH_OK,				"ok\n\r")
+DLOG_MSG(DL_SH_BADVAL,			"bad value\n\r")
+DLOG_MSG(DL_SH_PORT1,			"u%ld rx %ld tx %ld ovf %ld\n\r")
+DLOG_MSG(DL_SH_PORT2,			"u%ld err %ld hwm rx %ld tx %ld\n\r")
+DLOG_MSG(DL_SH_PORT3,			"u%ld ring rx %ld tx %ld\n\r")
+DLOG_MSG(DL_SH_TIMES1,			"ms find %ld connect %ld\n\r")
+DLOG_MSG(DL_SH_TIMES2,			"ms wait %ld upload %ld\n\r")
+DLOG_MSG(DL_SH_CFG1,			"baud %ld connect %ld upcmd %ld\n\r")
+DLOG_MSG(DL_SH_CFG2,			"idle %ld report %ld lcds %ld saved %ld\n\r")
+DLOG_MSG(DL_SH_CFGMODE,			"mode %ld (1 tlm, 2 quiet)\n\r")
+DLOG_MSG(DL_SH_CFG3,			"debug u%ld host2 u%ld prio %ld bridges %ld\n\r")
+DLOG_MSG(DL_SH_SELFTEST,		"selftest timer %ld bauds %ld eeprom %ld\n\r")
+DLOG_MSG(DL_SH_BENCH,			"cycles rxrdy %ld txrdy %ld ms %ld idle %ld\n\r")
+DLOG_MSG(DL_SH_HIST,			"latency 0 pc>lcd 1 lcd>pc, built %ld\n\r")
+DLOG_MSG(DL_SH_PUMPS,			"pump 0 lcd>pc 1 pc>lcd\n\r")
+DLOG_MSG(DL_SH_PROF,			"isr 0 u0rx 1 u0udre 2 u2rx 3 u2udre, built %ld\n\r")
+DLOG_MSG(DL_SH_PROF2,			"isr 4 u3rx 5 u3udre 6 t5\n\r")
+DLOG_MSG(DL_SH_PROFBYTE,		"%ld cycles a byte @ %ld\n\r")
+DLOG_MSG(DL_SH_PROFVEC,			"isr%ld min %ld avg %ld max %ld\n\r")
+DLOG_MSG(DL_SH_PROFCNT,			"isr%ld calls %ld\n\r")
+DLOG_MSG(DL_SH_LOAD,			"isr %ld%% work %ld%% idle %ld%% loops/s %ld\n\r")
+DLOG_MSG(DL_SH_MEM1,			"ram static %ld heap %ld free %ld\n\r")
+DLOG_MSG(DL_SH_MEM2,			"stack now %ld max %ld untouched %ld\n\r")
+DLOG_MSG(DL_SH_PUMP,			"pump%ld moved %ld stall %ld yield %ld\n\r")
+DLOG_MSG(DL_SH_LCDS,			"lcds live %ld primary u%ld failed %ld\n\r")
+DLOG_MSG(DL_SH_LCDTAB,			"u%ld @ %ld fw %ld flash %ld\n\r")
+DLOG_MSG(DL_SH_RATE,			"b%ld %ld bytes %ld ms %ld B/s\n\r")
+DLOG_MSG(DL_SH_RATEALL,			"both %ld bytes %ld ms %ld B/s\n\r")
+DLOG_MSG(DL_SH_ARB,				"arb host2 u%ld prio %ld owner %ld cuts %ld\n\r")
+DLOG_MSG(DL_SH_ARBHOST,			"host%ld u%ld frames %ld\n\r")
+DLOG_MSG(DL_SH_ARBLCD,			"lcd replies %ld events %ld\n\r")
+DLOG_MSG(DL_SH_STOREHDR,		"sd card %ld copying to slot %ld (-1 none)\n\r")
+DLOG_MSG(DL_SH_STORE,			"slot %ld seq %ld %ld B crc %08lx\n\r")
+DLOG_MSG(DL_SH_NOTBUILT,		"not built in\n\r")
+DLOG_MSG(DL_SH_HISTBIN,			"lat%ld <%ld us %ld\n\r")
+
+DLOG_MSG(DL_DROPPED,			"log: %ld records dropped\n\r")
@@ -53,6 +53,7 @@
 
 #include <driver_init.h>
 #include <compiler.h>
+#include "isrprof.h"
 
 volatile uint64_t msectimer0 = 0;		// global 1mS tick count
 
@@ -60,9 +61,11 @@ ISR(TIMER5_COMPA_vect)
 {
 	/* Insert your TIMER_5 compare channel A interrupt handling code here */
 	static uint16_t nextcmp = 0;
+	PROF_ENTER();
 
 	nextcmp = nextcmp + 16000;		// 1mSec assuming 16MHz clock
 	OCR5AH = nextcmp >> 8 ;
 	OCR5AL = nextcmp & 0xff;
 	msectimer0++;
+	PROF_EXIT(PV_T5CMPA);
 }
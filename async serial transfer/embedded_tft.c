@@ -0,0 +1,104 @@
+// TFT image in program flash, see embedded_tft.h and src/embedded_tft.S
+
+#include <atmel_start.h>
+#include <avr/pgmspace.h>
+#include <avr/eeprom.h>
+#include <string.h>
+#include <bridge_config.h>
+#include "crc32.h"
+#include "embedded_tft.h"
+#include "replay.h"
+
+#if EMBED_TFT
+
+#define STAMP_SPAN	4096		// bytes from each end of the image that go in its stamp
+
+extern const uint8_t embedded_tft_start[] PROGMEM;
+extern const uint8_t embedded_tft_end[] PROGMEM;
+
+static const char embed_model[] PROGMEM = EMBED_TFT_MODEL;
+
+static uint32_t EEMEM ee_stamp;		// stamp of the image last flashed from here
+
+bool embedded_tft(uint_farptr_t *at, uint32_t *size)
+{
+	*at = pgm_get_far_address(embedded_tft_start);
+	*size = pgm_get_far_address(embedded_tft_end) - *at;
+	return(*size != 0);
+}
+
+bool embedded_tft_fits(const char *model)
+{
+	if (pgm_read_byte(&embed_model[0]) == '\0')		// built without a model, trust it
+	{
+		return(true);
+	}
+	return(strcmp_P(model, embed_model) == 0);
+}
+
+// tells one image from another without reading all of it: its size and
+// a CRC of the head and tail, where the Nextion header and the last
+// resources are
+static uint32_t embedded_stamp(void)
+{
+	uint_farptr_t at;
+	uint32_t size, off, crc;
+	uint8_t chunk[32], n;
+
+	if (!embedded_tft(&at, &size))
+	{
+		return(0);
+	}
+	crc = CRC32_INIT;
+	off = 0;
+	while (off < size)
+	{
+		if ((off == STAMP_SPAN) && (size > 2 * STAMP_SPAN))
+		{
+			off = size - STAMP_SPAN;		// skip the middle
+		}
+		n = (size - off < sizeof chunk) ? size - off : sizeof chunk;
+		memcpy_PF(chunk, at + off, n);
+		crc = crc32_block(crc, chunk, n);
+		off += n;
+	}
+	return(crc32_final(crc) ^ size);
+}
+
+void embedded_tft_boot(void)
+{
+	if (EMBED_TFT_BOOT && (eeprom_read_dword(&ee_stamp) != embedded_stamp()))
+	{
+		replay_request(REPLAY_EMBEDDED);		// goes ahead once the display is found
+	}
+}
+
+void embedded_tft_flashed(void)
+{
+	eeprom_update_dword(&ee_stamp, embedded_stamp());
+}
+
+#else
+
+bool embedded_tft(uint_farptr_t *at, uint32_t *size)
+{
+	*at = 0;
+	*size = 0;
+	return(false);
+}
+
+bool embedded_tft_fits(const char *model)
+{
+	UNUSED(model);
+	return(false);
+}
+
+void embedded_tft_boot(void)
+{
+}
+
+void embedded_tft_flashed(void)
+{
+}
+
+#endif
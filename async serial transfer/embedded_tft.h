@@ -0,0 +1,27 @@
+// TFT image carried in the Mega's own flash (EMBED_TFT)
+//
+// A build with EMBED_TFT set holds a panel image next to the firmware and
+// can flash it onto the display through the replay path (replay.h) at the
+// fastest baud the display takes, on request or on the first boot after
+// the image changed.
+
+#ifndef EMBEDDED_TFT_H_INCLUDED
+#define EMBEDDED_TFT_H_INCLUDED
+
+#include <compiler.h>
+#include <avr/pgmspace.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+bool embedded_tft(uint_farptr_t *at, uint32_t *size);	// false if none is built in
+bool embedded_tft_fits(const char *model);	// built for this display model
+void embedded_tft_boot(void);		// at reset: ask for a flash if this image hasn't been sent yet
+void embedded_tft_flashed(void);	// it has now, don't do it again next boot
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EMBEDDED_TFT_H_INCLUDED */
@@ -0,0 +1,203 @@
+// Broadcast upload to several displays, see fanout.h
+// Like the pumps, nothing here waits on a port: a full display ring holds
+// the PC stream in the USART0 RX ring, and fanout_check() decides when a
+// display has held it up for long enough to be dropped.
+
+#include <atmel_start.h>
+#include <string.h>
+#include <bridge_config.h>
+#include "bridge.h"
+#include "dlog.h"
+#include "fanout.h"
+#include "progress.h"
+
+void fanout_init(struct fanout *f, uint8_t src, uint8_t lcds, uint8_t burst,
+		void (*down_seen)(void *, uint8_t), void (*up_seen)(void *, uint8_t), void *ctx)
+{
+	memset(f, 0, sizeof *f);
+	f->src = src;
+	f->live = lcds;
+	f->burst = burst ? burst : 255;
+	f->down_seen = down_seen;
+	f->up_seen = up_seen;
+	f->ctx = ctx;
+	for (f->primary = 0; !(lcds & (1 << f->primary)) && (f->primary < NPORTS - 1); f->primary++)
+	;
+}
+
+static void fan_drop(struct fanout *f, uint8_t port, uint8_t why)
+{
+	f->live &= ~(1 << port);
+	f->failed |= 1 << port;
+	dlog2((why == FAN_STALL) ? DL_FAN_STALL : DL_FAN_NOACK, port, f->moved);
+	if ((port == f->primary) && f->live)		// replies now come from the lowest one left
+	{
+		for (f->primary = 0; !(f->live & (1 << f->primary)); f->primary++)
+		;
+	}
+}
+
+// every live display has room for one more byte
+static bool fan_room(struct fanout *f)
+{
+	uint8_t p;
+
+	for (p = 0; p < NPORTS; p++)
+	{
+		if ((f->live & (1 << p)) && !ports[p].tx_ready())
+		{
+			return(false);
+		}
+	}
+	return(true);
+}
+
+// pass on the acks every live display has sent, and note when they differ
+static void fan_acks(struct fanout *f)
+{
+	uint16_t lo = 0xffff, hi = 0;
+	uint8_t p;
+
+	if (f->live == 0)
+	{
+		return;
+	}
+	for (p = 0; p < NPORTS; p++)
+	{
+		if (f->live & (1 << p))
+		{
+			if (f->acks[p] < lo)
+			{
+				lo = f->acks[p];
+			}
+			if (f->acks[p] > hi)
+			{
+				hi = f->acks[p];
+			}
+		}
+	}
+	while ((f->acks_sent != lo) && ports[f->src].tx_ready())
+	{
+		ports[f->src].write(NEX_ACK);
+		f->acks_sent++;
+		if (f->up_seen)
+		{
+			f->up_seen(f->ctx, NEX_ACK);
+		}
+	}
+	if (hi == lo)
+	{
+		f->uneven = false;
+	}
+	else if (!f->uneven)
+	{
+		f->uneven = true;
+		f->uneven_start = (uint32_t)msectime();
+	}
+}
+
+uint8_t fanout_down(struct fanout *f)
+{
+	const struct port *src = &ports[f->src];
+	uint8_t n, p, ch;
+
+	for (n = 0; src->rx_ready() && (n < f->burst); n++)
+	{
+		if (!fan_room(f))
+		{
+			f->stalls++;		// leave it in the PC ring until they all have room
+			if (!f->stalling)
+			{
+				f->stalling = true;
+				f->stall_start = (uint32_t)msectime();
+			}
+			break;
+		}
+		f->stalling = false;
+		ch = src->read();
+		for (p = 0; p < NPORTS; p++)
+		{
+			if (f->live & (1 << p))
+			{
+				ports[p].write(ch);
+			}
+		}
+		if (f->down_seen)
+		{
+			f->down_seen(f->ctx, ch);
+		}
+	}
+	f->moved += n;
+	return(n);
+}
+
+uint8_t fanout_up(struct fanout *f)
+{
+	uint8_t n = 0, p, ch;
+
+	for (p = 0; p < NPORTS; p++)
+	{
+		if (!(f->live & (1 << p)))
+		{
+			continue;
+		}
+		while (ports[p].rx_ready())
+		{
+			ch = ports[p].read();
+			n++;
+			if (ch == NEX_ACK)
+			{
+				f->acks[p]++;
+			}
+			else if (p == f->primary)		// the others' replies are dropped
+			{
+				ports[f->src].write(ch);
+				if (f->up_seen)
+				{
+					f->up_seen(f->ctx, ch);
+				}
+			}
+		}
+	}
+	fan_acks(f);
+	return(n);
+}
+
+void fanout_check(struct fanout *f)
+{
+	uint32_t now;
+	uint16_t hi = 0;
+	uint8_t p;
+
+	now = (uint32_t)msectime();
+	if (f->stalling && (now - f->stall_start > FANOUT_STALL_MS))
+	{
+		for (p = 0; p < NPORTS; p++)
+		{
+			if ((f->live & (1 << p)) && !ports[p].tx_ready())
+			{
+				fan_drop(f, p, FAN_STALL);
+			}
+		}
+		f->stalling = false;
+	}
+	if (f->uneven && (now - f->uneven_start > FANOUT_ACK_MS))
+	{
+		for (p = 0; p < NPORTS; p++)
+		{
+			if ((f->live & (1 << p)) && (f->acks[p] > hi))
+			{
+				hi = f->acks[p];
+			}
+		}
+		for (p = 0; p < NPORTS; p++)
+		{
+			if ((f->live & (1 << p)) && (f->acks[p] < hi))
+			{
+				fan_drop(f, p, FAN_NOACK);
+			}
+		}
+		f->uneven = false;
+		fan_acks(f);		// the ones left may all be level now
+	}
+}
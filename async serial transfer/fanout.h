@@ -0,0 +1,55 @@
+// Broadcast upload: one PC stream copied to several displays
+//
+// Every PC byte goes to every live display, and only when all of them
+// have room for it, so they all see the same stream. Each display's 0x05
+// acks are counted and one is passed to the PC when every live display
+// has acked that chunk. Other replies are passed on from the primary only.
+// A display that holds the stream up or falls behind on acks for too long
+// is dropped from the set and logged; the rest carry on without it.
+
+#ifndef FANOUT_H_INCLUDED
+#define FANOUT_H_INCLUDED
+
+#include <compiler.h>
+#include "ports.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// why a display was dropped, logged as DL_FAN_STALL or DL_FAN_NOACK
+enum fan_reason {
+	FAN_STALL = 1,		// its TX ring stayed full
+	FAN_NOACK = 2		// the others acked a chunk it never did
+};
+
+struct fanout {
+	uint8_t src;					// PC port
+	uint8_t live;					// displays still in the upload, bit per port
+	uint8_t failed;					// displays dropped this upload
+	uint8_t primary;				// non-ack replies come from this one
+	uint8_t burst;					// most PC bytes copied per call
+	uint16_t acks[NPORTS];			// acks from each display
+	uint16_t acks_sent;				// combined acks passed to the PC
+	bool stalling;					// a display had no room for the last PC byte
+	bool uneven;					// some display has acked more chunks than another
+	uint32_t stall_start;			// msectime() each of those started
+	uint32_t uneven_start;
+	uint32_t moved;					// PC bytes copied
+	uint32_t stalls;				// calls held up by a full display ring
+	void (*down_seen)(void *ctx, uint8_t ch);	// every PC byte copied, may be NULL
+	void (*up_seen)(void *ctx, uint8_t ch);		// every byte passed to the PC, may be NULL
+	void *ctx;						// passed to both, the bridge it belongs to
+};
+
+void fanout_init(struct fanout *f, uint8_t src, uint8_t lcds, uint8_t burst,
+		void (*down_seen)(void *, uint8_t), void (*up_seen)(void *, uint8_t), void *ctx);
+uint8_t fanout_down(struct fanout *f);		// PC bytes copied this call
+uint8_t fanout_up(struct fanout *f);		// display bytes read this call
+void fanout_check(struct fanout *f);		// drop displays that are holding things up
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FANOUT_H_INCLUDED */
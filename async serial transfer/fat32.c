@@ -0,0 +1,493 @@
+// Minimal FAT32, see fat32.h
+// No long names, no subdirectories, no seeking: the store only ever
+// writes an image straight through and reads it back the same way.
+// FAT changes are made in the window and written to every FAT copy when
+// the window moves on or fat_flush() is called.
+
+#include <string.h>
+#include "fat32.h"
+
+#define NO_SECTOR	0xffffffffUL
+#define FAT_MASK	0x0fffffffUL
+#define FAT_EOC		0x0fffffffUL		// end of chain, as written
+#define FAT_LAST	0x0ffffff8UL		// end of chain, anything from here up
+#define FAT_ERR		0xffffffffUL		// fat_get() could not read the FAT
+#define DIRENT		32
+#define FAT_DATE	0x0021				// 1980-01-01, there is no clock to go by
+
+static uint16_t get16(const uint8_t *p)
+{
+	return((uint16_t)(p[0] | ((uint16_t)p[1] << 8)));
+}
+
+static uint32_t get32(const uint8_t *p)
+{
+	return((uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24));
+}
+
+static void put16(uint8_t *p, uint16_t v)
+{
+	p[0] = v & 0xff;
+	p[1] = v >> 8;
+}
+
+static void put32(uint8_t *p, uint32_t v)
+{
+	p[0] = v & 0xff;
+	p[1] = (v >> 8) & 0xff;
+	p[2] = (v >> 16) & 0xff;
+	p[3] = v >> 24;
+}
+
+bool fat_flush(struct fat_vol *v)
+{
+	uint8_t i;
+
+	if (!v->win_dirty)
+	{
+		return(true);
+	}
+	v->win_dirty = false;
+	if (!v->dev->write(v->dev->ctx, v->win_lba, v->win))
+	{
+		return(false);
+	}
+	if ((v->win_lba >= v->fat_lba) && (v->win_lba < v->fat_lba + v->fat_size))
+	{
+		for (i = 1; i < v->nfats; i++)		// keep the other copies the same
+		{
+			if (!v->dev->write(v->dev->ctx, v->win_lba + i * v->fat_size, v->win))
+			{
+				return(false);
+			}
+		}
+	}
+	return(true);
+}
+
+bool fat_release(struct fat_vol *v)
+{
+	bool ok;
+
+	ok = fat_flush(v);
+	v->win_lba = NO_SECTOR;
+	return(ok);
+}
+
+static bool win_load(struct fat_vol *v, uint32_t lba)
+{
+	if (v->win_lba == lba)
+	{
+		return(true);
+	}
+	if (!fat_flush(v))
+	{
+		return(false);
+	}
+	if (!v->dev->read(v->dev->ctx, lba, v->win))
+	{
+		v->win_lba = NO_SECTOR;
+		return(false);
+	}
+	v->win_lba = lba;
+	return(true);
+}
+
+static bool cluster_ok(const struct fat_vol *v, uint32_t cl)
+{
+	return((cl >= 2) && (cl < v->nclusters + 2));
+}
+
+static uint32_t cluster_lba(const struct fat_vol *v, uint32_t cl)
+{
+	return(v->data_lba + (cl - 2) * v->spc);
+}
+
+static uint32_t fat_get(struct fat_vol *v, uint32_t cl)
+{
+	if (!win_load(v, v->fat_lba + cl / (BLOCK_SIZE / 4)))
+	{
+		return(FAT_ERR);
+	}
+	return(get32(&v->win[(cl % (BLOCK_SIZE / 4)) * 4]) & FAT_MASK);
+}
+
+static bool fat_set(struct fat_vol *v, uint32_t cl, uint32_t next)
+{
+	uint8_t *p;
+
+	if (!win_load(v, v->fat_lba + cl / (BLOCK_SIZE / 4)))
+	{
+		return(false);
+	}
+	p = &v->win[(cl % (BLOCK_SIZE / 4)) * 4];
+	put32(p, (get32(p) & ~FAT_MASK) | next);		// the top 4 bits are reserved, keep them
+	v->win_dirty = true;
+	return(true);
+}
+
+// a free cluster, chained on from prev unless that is 0; 0 if the card is full
+static uint32_t fat_alloc(struct fat_vol *v, uint32_t prev)
+{
+	uint32_t cl, n, e;
+
+	cl = v->hint;
+	for (n = 0; n < v->nclusters; n++, cl++)
+	{
+		if (!cluster_ok(v, cl))
+		{
+			cl = 2;
+		}
+		e = fat_get(v, cl);
+		if (e == FAT_ERR)
+		{
+			return(0);
+		}
+		if (e == 0)
+		{
+			if (!fat_set(v, cl, FAT_EOC) || ((prev != 0) && !fat_set(v, prev, cl)))
+			{
+				return(0);
+			}
+			v->hint = cl + 1;
+			return(cl);
+		}
+	}
+	return(0);
+}
+
+static bool fat_free_chain(struct fat_vol *v, uint32_t cl)
+{
+	uint32_t next;
+
+	while (cluster_ok(v, cl))
+	{
+		next = fat_get(v, cl);
+		if ((next == FAT_ERR) || !fat_set(v, cl, 0))
+		{
+			return(false);
+		}
+		if (cl < v->hint)
+		{
+			v->hint = cl;
+		}
+		cl = next;
+	}
+	return(true);
+}
+
+// a boot sector with a FAT32 BPB: 512 byte sectors, no FAT12/16 root or FAT size
+static bool is_fat32(const uint8_t *b)
+{
+	return((get16(&b[11]) == BLOCK_SIZE) && (b[13] != 0) && ((b[13] & (b[13] - 1)) == 0) &&
+			(b[16] != 0) && (get16(&b[17]) == 0) && (get16(&b[22]) == 0));
+}
+
+bool fat_mount(struct fat_vol *v, const struct blockdev *dev, uint8_t *win)
+{
+	uint32_t part, total;
+	uint16_t reserved, fsinfo;
+	const uint8_t *pe;
+
+	memset(v, 0, sizeof *v);
+	v->dev = dev;
+	v->win = win;
+	v->win_lba = NO_SECTOR;
+
+	// sector 0 is either the boot sector (no partition table) or an MBR
+	if (!win_load(v, 0) || (win[510] != 0x55) || (win[511] != 0xaa))
+	{
+		return(false);
+	}
+	part = 0;
+	if (!is_fat32(win))
+	{
+		pe = &win[0x1be];		// first partition entry
+		if ((pe[4] != 0x0b) && (pe[4] != 0x0c))
+		{
+			return(false);
+		}
+		part = get32(&pe[8]);
+		if (!win_load(v, part) || !is_fat32(win))
+		{
+			return(false);
+		}
+	}
+
+	v->spc = win[13];
+	reserved = get16(&win[14]);
+	v->nfats = win[16];
+	total = get16(&win[19]) ? get16(&win[19]) : get32(&win[32]);
+	v->fat_size = get32(&win[36]);
+	v->root = get32(&win[44]) & FAT_MASK;
+	fsinfo = get16(&win[48]);
+	v->fat_lba = part + reserved;
+	v->data_lba = v->fat_lba + v->nfats * v->fat_size;
+	v->nclusters = (total - (v->data_lba - part)) / v->spc;
+	v->hint = 2;
+	if (!cluster_ok(v, v->root))
+	{
+		return(false);
+	}
+
+	// the free count there goes stale as soon as we allocate, so mark it
+	// unknown and let the next PC to see the card count for itself
+	if ((fsinfo != 0) && (fsinfo < reserved) && win_load(v, part + fsinfo) && (get32(win) == 0x41615252UL))
+	{
+		if ((get32(&win[488]) != 0xffffffffUL) || (get32(&win[492]) != 0xffffffffUL))
+		{
+			put32(&win[488], 0xffffffffUL);
+			put32(&win[492], 0xffffffffUL);
+			v->win_dirty = true;
+		}
+	}
+	return(fat_flush(v));
+}
+
+// look for name in the root directory: 1 found, 0 not there, -1 on an
+// error. With make, a free entry for it is found (growing the directory
+// if need be) and left at *lba and *off when it is not there.
+static int8_t dir_lookup(struct fat_vol *v, const char *name, bool make, uint32_t *lba, uint16_t *off)
+{
+	uint32_t cl, next, free_lba, sec;
+	uint16_t o, free_off;
+	uint8_t s;
+	const uint8_t *e;
+
+	free_lba = NO_SECTOR;
+	free_off = 0;
+	cl = v->root;
+	for (;;)
+	{
+		for (s = 0; s < v->spc; s++)
+		{
+			sec = cluster_lba(v, cl) + s;
+			if (!win_load(v, sec))
+			{
+				return(-1);
+			}
+			for (o = 0; o < BLOCK_SIZE; o += DIRENT)
+			{
+				e = &v->win[o];
+				if ((e[0] == 0x00) || (e[0] == 0xe5))		// end of the directory, or a deleted entry
+				{
+					if (free_lba == NO_SECTOR)
+					{
+						free_lba = sec;
+						free_off = o;
+					}
+					if (e[0] == 0x00)
+					{
+						goto not_found;
+					}
+				}
+				else if (!(e[11] & 0x18) && (memcmp(e, name, 11) == 0))		// not a directory or volume label
+				{
+					*lba = sec;
+					*off = o;
+					return(1);
+				}
+			}
+		}
+		next = fat_get(v, cl);
+		if (next == FAT_ERR)
+		{
+			return(-1);
+		}
+		if (!cluster_ok(v, next))
+		{
+			break;
+		}
+		cl = next;
+	}
+
+not_found:
+	if (!make)
+	{
+		return(0);
+	}
+	if (free_lba == NO_SECTOR)		// directory full, give it another cluster
+	{
+		next = fat_alloc(v, cl);
+		if ((next == 0) || !fat_flush(v))
+		{
+			return(-1);
+		}
+		memset(v->win, 0, BLOCK_SIZE);
+		for (s = 0; s < v->spc; s++)
+		{
+			if (!v->dev->write(v->dev->ctx, cluster_lba(v, next) + s, v->win))
+			{
+				return(-1);
+			}
+		}
+		v->win_lba = cluster_lba(v, next) + v->spc - 1;		// the window holds zeros, same as that sector
+		free_lba = cluster_lba(v, next);
+		free_off = 0;
+	}
+	*lba = free_lba;
+	*off = free_off;
+	return(0);
+}
+
+bool fat_open(struct fat_vol *v, struct fat_file *f, const char *name, uint8_t *buf)
+{
+	const uint8_t *e;
+
+	memset(f, 0, sizeof *f);
+	f->v = v;
+	f->buf = buf;
+	if (dir_lookup(v, name, false, &f->dir_lba, &f->dir_off) != 1)
+	{
+		return(false);
+	}
+	e = &v->win[f->dir_off];
+	f->first = ((uint32_t)get16(&e[20]) << 16) | get16(&e[26]);
+	f->size = get32(&e[28]);
+	f->cluster = f->first;
+	return((f->size == 0) || cluster_ok(v, f->first));
+}
+
+bool fat_create(struct fat_vol *v, struct fat_file *f, const char *name, uint8_t *buf)
+{
+	uint8_t *e;
+	int8_t found;
+
+	memset(f, 0, sizeof *f);
+	f->v = v;
+	f->buf = buf;
+	found = dir_lookup(v, name, true, &f->dir_lba, &f->dir_off);
+	if (found < 0)
+	{
+		return(false);
+	}
+	if (found)		// start it again from empty
+	{
+		e = &v->win[f->dir_off];
+		if (!fat_free_chain(v, ((uint32_t)get16(&e[20]) << 16) | get16(&e[26])))
+		{
+			return(false);
+		}
+	}
+	if (!win_load(v, f->dir_lba))
+	{
+		return(false);
+	}
+	e = &v->win[f->dir_off];
+	memset(e, 0, DIRENT);
+	memcpy(e, name, 11);
+	e[11] = 0x20;		// archive
+	put16(&e[16], FAT_DATE);
+	put16(&e[18], FAT_DATE);
+	put16(&e[24], FAT_DATE);
+	v->win_dirty = true;
+	f->writing = true;
+	return(fat_flush(v));
+}
+
+// f->buf holds the sector starting at file offset at, write it out
+static bool write_sector(struct fat_file *f, uint32_t at)
+{
+	struct fat_vol *v = f->v;
+	uint32_t cl;
+	uint8_t s;
+
+	s = (at / BLOCK_SIZE) % v->spc;
+	if (s == 0)		// first sector of a new cluster
+	{
+		cl = fat_alloc(v, f->cluster);
+		if (cl == 0)
+		{
+			return(false);
+		}
+		if (f->first == 0)
+		{
+			f->first = cl;
+		}
+		f->cluster = cl;
+	}
+	return(v->dev->write(v->dev->ctx, cluster_lba(v, f->cluster) + s, f->buf));
+}
+
+bool fat_write(struct fat_file *f, const uint8_t *p, uint16_t n)
+{
+	if (!f->writing)
+	{
+		return(false);
+	}
+	while (n--)
+	{
+		f->buf[f->pos % BLOCK_SIZE] = *p++;
+		if ((++f->pos % BLOCK_SIZE) == 0)
+		{
+			if (!write_sector(f, f->pos - BLOCK_SIZE))
+			{
+				f->writing = false;
+				return(false);
+			}
+		}
+	}
+	return(true);
+}
+
+bool fat_close(struct fat_file *f)
+{
+	struct fat_vol *v = f->v;
+	uint16_t part;
+	uint8_t *e;
+
+	if (!f->writing)
+	{
+		return(true);
+	}
+	f->writing = false;
+	part = f->pos % BLOCK_SIZE;
+	if (part)		// the last, short sector
+	{
+		memset(&f->buf[part], 0, BLOCK_SIZE - part);
+		if (!write_sector(f, f->pos - part))
+		{
+			return(false);
+		}
+	}
+	f->size = f->pos;
+	if (!win_load(v, f->dir_lba))
+	{
+		return(false);
+	}
+	e = &v->win[f->dir_off];
+	put16(&e[20], f->first >> 16);
+	put16(&e[26], f->first & 0xffff);
+	put32(&e[28], f->size);
+	v->win_dirty = true;
+	return(fat_flush(v));
+}
+
+uint16_t fat_read_sector(struct fat_file *f)
+{
+	struct fat_vol *v = f->v;
+	uint32_t left;
+	uint8_t s;
+
+	if (f->writing || (f->pos >= f->size))
+	{
+		return(0);
+	}
+	s = (f->pos / BLOCK_SIZE) % v->spc;
+	if ((s == 0) && (f->pos != 0))		// on to the next cluster
+	{
+		f->cluster = fat_get(v, f->cluster);
+	}
+	if (!cluster_ok(v, f->cluster) || !v->dev->read(v->dev->ctx, cluster_lba(v, f->cluster) + s, f->buf))
+	{
+		f->pos = f->size;		// no more from this one
+		return(0);
+	}
+	left = f->size - f->pos;
+	if (left > BLOCK_SIZE)
+	{
+		left = BLOCK_SIZE;
+	}
+	f->pos += left;
+	return((uint16_t)left);
+}
@@ -0,0 +1,62 @@
+// Just enough FAT32 to keep TFT images on an SD card
+//
+// Files live in the root directory under 8.3 names, given as the 11 byte
+// directory form ("TFT0    BIN"). A file is written once from the start,
+// a sector at a time as it streams in, and read back a sector at a time.
+// Only the block device below is hardware; everything here builds on a PC.
+//
+// The caller owns the RAM: a sector window for the FAT and directory in
+// fat_vol, and a data sector per open file.
+
+#ifndef FAT32_H_INCLUDED
+#define FAT32_H_INCLUDED
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "blockdev.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct fat_vol {
+	const struct blockdev *dev;
+	uint8_t *win;					// BLOCK_SIZE bytes for FAT and directory sectors
+	uint32_t win_lba;				// sector in win, 0xffffffff for none
+	bool win_dirty;
+	uint32_t fat_lba;				// first FAT
+	uint32_t fat_size;				// sectors in each FAT
+	uint8_t nfats;
+	uint8_t spc;					// sectors per cluster
+	uint32_t data_lba;				// cluster 2
+	uint32_t root;					// root directory's first cluster
+	uint32_t nclusters;				// data clusters, numbered from 2
+	uint32_t hint;					// where to look for a free cluster next
+};
+
+struct fat_file {
+	struct fat_vol *v;
+	uint8_t *buf;					// BLOCK_SIZE bytes of file data
+	uint32_t first;					// first cluster, 0 while empty
+	uint32_t cluster;				// cluster pos is in
+	uint32_t size;
+	uint32_t pos;					// bytes written or read so far
+	uint32_t dir_lba;				// sector and offset of its directory entry
+	uint16_t dir_off;
+	bool writing;
+};
+
+bool fat_mount(struct fat_vol *v, const struct blockdev *dev, uint8_t *win);
+bool fat_open(struct fat_vol *v, struct fat_file *f, const char *name, uint8_t *buf);		// to read
+bool fat_create(struct fat_vol *v, struct fat_file *f, const char *name, uint8_t *buf);	// empty, to write
+bool fat_write(struct fat_file *f, const uint8_t *p, uint16_t n);	// append
+bool fat_close(struct fat_file *f);		// flush and set the size, after writing
+uint16_t fat_read_sector(struct fat_file *f);	// next sector into f->buf, bytes in it; 0 at the end or on an error
+bool fat_flush(struct fat_vol *v);		// write back the window
+bool fat_release(struct fat_vol *v);	// write it back and forget it, its RAM is about to be used for something else
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FAT32_H_INCLUDED */
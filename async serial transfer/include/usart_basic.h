@@ -58,17 +58,84 @@
 
 #include <atmel_start.h>
 #include <stdbool.h>
+#include <atomic.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-/* USART_0 Ringbuffer */
+/* Per USART traffic and error counters, updated from the ISRs */
+struct usart_stats {
+	uint32_t rx_bytes;     /* bytes received */
+	uint32_t tx_bytes;     /* bytes handed to the transmitter */
+	uint16_t rx_overflows; /* bytes dropped, the ring was full */
+	uint16_t rx_errors;    /* frame, data overrun or parity errors */
+	uint16_t rx_hwm;       /* receive ring high-water mark */
+	uint16_t tx_hwm;       /* transmit ring high-water mark */
+};
+
+/* Counters indexed by USART number; read them inside a critical section */
+extern volatile struct usart_stats USART_stats[4];
+
+/* Ring buffer whose storage comes from a shared pool, see usart_ring.c.
+ * Sizes are powers of 2. head is the last slot written, tail the last
+ * slot read. Only the ISR moves head of an RX ring and tail of a TX ring. */
+struct usart_ring {
+	uint8_t *         buf;
+	uint16_t *        stamp;    /* per byte RX time, LATENCY_HIST only */
+	uint16_t          mask;     /* size - 1 */
+	volatile uint16_t head;
+	volatile uint16_t tail;
+	volatile uint16_t elements;
+};
+
+#define USART_RX 0
+#define USART_TX 1
+
+/* Rings indexed by USART number and USART_RX/USART_TX */
+extern struct usart_ring USART_ring[4][2];
+
+/* elements is shared with the ISR and 16 bits wide, so read it atomically */
+static inline uint16_t usart_ring_count(struct usart_ring *r)
+{
+	uint16_t n;
+
+	ENTER_CRITICAL(R);
+	n = r->elements;
+	EXIT_CRITICAL(R);
+	return n;
+}
+
+/**
+ * \brief Carve the boot ring sizes out of the pool
+ *
+ * Must run before any USART is initialized.
+ */
+void usart_rings_init(void);
+
+/**
+ * \brief Reassign the pool between the rings
+ *
+ * Waits for every TX ring to empty, then with interrupts off moves any
+ * bytes still waiting in the RX rings into the new layout.
+ *
+ * \param[in] sizes_P Ring sizes in flash, [USART][USART_RX/USART_TX]
+ *
+ * \return Whether the new layout is in place
+ * \retval false More RX bytes were waiting than can be carried over;
+ *               the old layout is kept and nothing is lost
+ */
+bool usart_rings_resize(const uint16_t *sizes_P);
+
+/**
+ * \brief Size of one ring now
+ */
+uint16_t usart_ring_size(uint8_t usart, uint8_t dir);
+
+/* USART_0 ring sizes from reset, until usart_rings_resize() */
 
-#define USART_0_RX_BUFFER_SIZE 256
-#define USART_0_TX_BUFFER_SIZE 64
-#define USART_0_RX_BUFFER_MASK (USART_0_RX_BUFFER_SIZE - 1)
-#define USART_0_TX_BUFFER_MASK (USART_0_TX_BUFFER_SIZE - 1)
+#define USART_0_RX_BUFFER_SIZE 128
+#define USART_0_TX_BUFFER_SIZE 256
 
 /**
  * \brief Initialize USART interface
@@ -144,6 +211,20 @@ bool USART_0_is_rx_ready();
  */
 bool USART_0_is_tx_busy();
 
+/**
+ * \brief Number of received characters waiting in the USART_0 ring
+ *
+ * \return Receive ring occupancy
+ */
+uint16_t USART_0_rx_count();
+
+/**
+ * \brief Number of characters waiting to be sent from the USART_0 ring
+ *
+ * \return Transmit ring occupancy
+ */
+uint16_t USART_0_tx_count();
+
 /**
  * \brief Read one character from USART_0
  *
@@ -164,12 +245,10 @@ uint8_t USART_0_read(void);
  */
 void USART_0_write(const uint8_t data);
 
-/* USART_1 Ringbuffer */
+/* USART_1 ring sizes from reset, until usart_rings_resize() */
 
 #define USART_1_RX_BUFFER_SIZE 16
 #define USART_1_TX_BUFFER_SIZE 16
-#define USART_1_RX_BUFFER_MASK (USART_1_RX_BUFFER_SIZE - 1)
-#define USART_1_TX_BUFFER_MASK (USART_1_TX_BUFFER_SIZE - 1)
 
 /**
  * \brief Initialize USART interface
@@ -245,6 +324,20 @@ bool USART_1_is_rx_ready();
  */
 bool USART_1_is_tx_busy();
 
+/**
+ * \brief Number of received characters waiting in the USART_1 ring
+ *
+ * \return Receive ring occupancy
+ */
+uint16_t USART_1_rx_count();
+
+/**
+ * \brief Number of characters waiting to be sent from the USART_1 ring
+ *
+ * \return Transmit ring occupancy
+ */
+uint16_t USART_1_tx_count();
+
 /**
  * \brief Read one character from USART_1
  *
@@ -265,12 +358,10 @@ uint8_t USART_1_read(void);
  */
 void USART_1_write(const uint8_t data);
 
-/* USART_2 Ringbuffer */
+/* USART_2 ring sizes from reset, until usart_rings_resize() */
 
-#define USART_2_RX_BUFFER_SIZE 64
-#define USART_2_TX_BUFFER_SIZE 32
-#define USART_2_RX_BUFFER_MASK (USART_2_RX_BUFFER_SIZE - 1)
-#define USART_2_TX_BUFFER_MASK (USART_2_TX_BUFFER_SIZE - 1)
+#define USART_2_RX_BUFFER_SIZE 256
+#define USART_2_TX_BUFFER_SIZE 128
 
 /**
  * \brief Initialize USART interface
@@ -346,6 +437,20 @@ bool USART_2_is_rx_ready();
  */
 bool USART_2_is_tx_busy();
 
+/**
+ * \brief Number of received characters waiting in the USART_2 ring
+ *
+ * \return Receive ring occupancy
+ */
+uint16_t USART_2_rx_count();
+
+/**
+ * \brief Number of characters waiting to be sent from the USART_2 ring
+ *
+ * \return Transmit ring occupancy
+ */
+uint16_t USART_2_tx_count();
+
 /**
  * \brief Read one character from USART_2
  *
@@ -366,12 +471,10 @@ uint8_t USART_2_read(void);
  */
 void USART_2_write(const uint8_t data);
 
-/* USART_3 Ringbuffer */
+/* USART_3 ring sizes from reset, until usart_rings_resize() */
 
-#define USART_3_RX_BUFFER_SIZE 16
-#define USART_3_TX_BUFFER_SIZE 16
-#define USART_3_RX_BUFFER_MASK (USART_3_RX_BUFFER_SIZE - 1)
-#define USART_3_TX_BUFFER_MASK (USART_3_TX_BUFFER_SIZE - 1)
+#define USART_3_RX_BUFFER_SIZE 64
+#define USART_3_TX_BUFFER_SIZE 256
 
 /**
  * \brief Initialize USART interface
@@ -447,6 +550,20 @@ bool USART_3_is_rx_ready();
  */
 bool USART_3_is_tx_busy();
 
+/**
+ * \brief Number of received characters waiting in the USART_3 ring
+ *
+ * \return Receive ring occupancy
+ */
+uint16_t USART_3_rx_count();
+
+/**
+ * \brief Number of characters waiting to be sent from the USART_3 ring
+ *
+ * \return Transmit ring occupancy
+ */
+uint16_t USART_3_tx_count();
+
 /**
  * \brief Read one character from USART_3
  *
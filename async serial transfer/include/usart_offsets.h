@@ -0,0 +1,30 @@
+/**
+ * \file
+ *
+ * \brief Field offsets of the USART ring and stats structs
+ *
+ * For the assembler ISRs in usart_relay.S; usart_ring.c checks them
+ * against the C structs in usart_basic.h at compile time.
+ */
+#ifndef USART_OFFSETS_H_INCLUDED
+#define USART_OFFSETS_H_INCLUDED
+
+/* struct usart_ring */
+#define RING_OFF_BUF      0
+#define RING_OFF_STAMP    2
+#define RING_OFF_MASK     4
+#define RING_OFF_HEAD     6
+#define RING_OFF_TAIL     8
+#define RING_OFF_ELEMENTS 10
+#define RING_SIZEOF       12
+
+/* struct usart_stats */
+#define STATS_OFF_RXBYTES 0
+#define STATS_OFF_TXBYTES 4
+#define STATS_OFF_RXOVF   8
+#define STATS_OFF_RXERR   10
+#define STATS_OFF_RXHWM   12
+#define STATS_OFF_TXHWM   14
+#define STATS_SIZEOF      16
+
+#endif /* USART_OFFSETS_H_INCLUDED */
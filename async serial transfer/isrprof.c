@@ -0,0 +1,45 @@
+// ISR cycle cost profiler, see isrprof.h
+
+#include <atmel_start.h>
+#include <string.h>
+#include <atomic.h>
+#include "isrprof.h"
+
+#if CPU_LOAD
+volatile uint32_t isr_cycles;
+#endif
+
+#if PROFILE_ISR
+
+struct isr_prof isr_prof[PV_N];
+
+void isr_prof_clear(void)
+{
+	ENTER_CRITICAL(W);
+	memset(isr_prof, 0, sizeof isr_prof);
+	EXIT_CRITICAL(W);
+}
+
+// copy of one vector's figures, false if it has not run since the clear
+bool isr_prof_get(uint8_t v, struct isr_prof *p)
+{
+	ENTER_CRITICAL(R);
+	*p = isr_prof[v];
+	EXIT_CRITICAL(R);
+	return(p->count != 0);
+}
+
+#else
+
+void isr_prof_clear(void)
+{
+}
+
+bool isr_prof_get(uint8_t v, struct isr_prof *p)
+{
+	UNUSED(v);
+	memset(p, 0, sizeof *p);
+	return(false);
+}
+
+#endif
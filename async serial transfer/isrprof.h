@@ -0,0 +1,76 @@
+// ISR cycle cost profiler
+// With PROFILE_ISR set each profiled vector reads timer 5 (free-running at
+// the cpu clock) on entry and exit and keeps min/max/total cycles and a call
+// count. The compiler generated register saves and restores, plus the 7-8
+// cycles of vectoring and reti, are outside the measured span.
+
+#ifndef ISRPROF_H_INCLUDED
+#define ISRPROF_H_INCLUDED
+
+#include <compiler.h>
+#include <bridge_config.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum prof_vec { PV_U0RX, PV_U0UDRE, PV_U2RX, PV_U2UDRE, PV_U3RX, PV_U3UDRE, PV_T5CMPA, PV_N };
+
+struct isr_prof {
+	uint16_t min;
+	uint16_t max;
+	uint32_t total;
+	uint32_t count;
+};
+
+#if PROFILE_ISR
+extern struct isr_prof isr_prof[PV_N];
+#endif
+#if CPU_LOAD
+extern volatile uint32_t isr_cycles;	// all profiled vectors together, see cpuload.h
+#endif
+
+#if PROFILE_ISR || CPU_LOAD
+
+// ISRs don't nest here, so the 16 bit timer reads need no protection
+#define PROF_ENTER()	uint16_t prof_t0 = TCNT5
+#define PROF_EXIT(v)	isr_prof_add(v, TCNT5 - prof_t0)
+
+static inline void isr_prof_add(uint8_t v, uint16_t cyc)
+{
+#if CPU_LOAD
+	isr_cycles += cyc;
+#endif
+#if PROFILE_ISR
+	struct isr_prof *p = &isr_prof[v];
+
+	if ((p->count == 0) || (cyc < p->min))
+	{
+		p->min = cyc;
+	}
+	if (cyc > p->max)
+	{
+		p->max = cyc;
+	}
+	p->total += cyc;
+	p->count++;
+#else
+	UNUSED(v);
+#endif
+}
+
+#else
+
+#define PROF_ENTER()
+#define PROF_EXIT(v)
+
+#endif
+
+void isr_prof_clear(void);
+bool isr_prof_get(uint8_t v, struct isr_prof *p);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ISRPROF_H_INCLUDED */
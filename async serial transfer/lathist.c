@@ -0,0 +1,56 @@
+// Forwarding latency histograms, see lathist.h
+
+#include <atmel_start.h>
+#include <string.h>
+#include <atomic.h>
+#include "lathist.h"
+
+#if LATENCY_HIST
+
+volatile uint16_t lat_hist[LAT_NDIRS][LAT_BINS];
+volatile bool lat_on;
+uint16_t lat_stamp[LAT_NDIRS];
+
+// only bytes bridged while this is on are counted, the bridge's own
+// probes and commands would otherwise show up with stale stamps
+void lat_enable(bool on)
+{
+	lat_on = on;
+}
+
+void lat_clear(void)
+{
+	ENTER_CRITICAL(W);
+	memset((void *)lat_hist, 0, sizeof lat_hist);
+	EXIT_CRITICAL(W);
+}
+
+uint16_t lat_count(uint8_t dir, uint8_t bin)
+{
+	uint16_t n;
+
+	ENTER_CRITICAL(R);
+	n = lat_hist[dir][bin];
+	EXIT_CRITICAL(R);
+	return(n);
+}
+
+#else
+
+void lat_enable(bool on)
+{
+	UNUSED(on);
+}
+
+void lat_clear(void)
+{
+}
+
+uint16_t lat_count(uint8_t dir, uint8_t bin)
+{
+	UNUSED(dir);
+	UNUSED(bin);
+	return(0);
+}
+
+#endif
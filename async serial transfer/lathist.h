@@ -0,0 +1,65 @@
+// Per-byte forwarding latency, RX interrupt to UDR load, as log2 histograms
+// Each bridged byte gets a 16 bit timestamp in the RX ISR. The stamp follows
+// the byte through the main loop (read on one port, write on the other) and
+// the UDRE ISR that loads it into UDR adds the wait to its direction's
+// histogram. Compiled out entirely unless LATENCY_HIST is set.
+
+#ifndef LATHIST_H_INCLUDED
+#define LATHIST_H_INCLUDED
+
+#include <compiler.h>
+#include <bridge_config.h>
+#include "timebase.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum lat_dir { LAT_PC2LCD, LAT_LCD2PC, LAT_NDIRS };
+
+#define LAT_BINS		16		// bin n counts waits of 2^n to 2^(n+1)-1 ticks
+#define LAT_TICK_US		4		// so stamps wrap after 262mS
+#define LAT_TICK_CYCLES	(F_CPU / (1000000UL / LAT_TICK_US))
+
+#if LATENCY_HIST
+
+extern volatile uint16_t lat_hist[LAT_NDIRS][LAT_BINS];
+extern volatile bool lat_on;
+extern uint16_t lat_stamp[LAT_NDIRS];	// stamp of the byte last read, main line only
+
+// time in ticks, only good inside an ISR or with interrupts off
+static inline uint16_t lat_ticks(void)
+{
+	return((uint16_t)msectimer0 * (1000 / LAT_TICK_US) + tb_cycles_in_ms() / LAT_TICK_CYCLES);
+}
+
+// from a UDRE ISR: the byte stamped at stamp is going out now
+static inline void lat_record(uint8_t dir, uint16_t stamp)
+{
+	uint16_t d;
+	uint8_t bin;
+
+	if (!lat_on)
+	{
+		return;
+	}
+	d = lat_ticks() - stamp;
+	for (bin = 0; (d >>= 1) != 0; bin++)
+	;
+	if (lat_hist[dir][bin] != 0xffff)
+	{
+		lat_hist[dir][bin]++;
+	}
+}
+
+#endif
+
+void lat_enable(bool on);
+void lat_clear(void);
+uint16_t lat_count(uint8_t dir, uint8_t bin);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LATHIST_H_INCLUDED */
@@ -0,0 +1,84 @@
+// LZSS unpacking, see lzss.h
+
+#include <string.h>
+#include "lzss.h"
+
+enum {
+	LZ_TOKEN,		// wants a flag byte, or the first byte of an item
+	LZ_LEN,			// wants a match's length
+	LZ_LIT,			// has a literal to give out
+	LZ_COPY			// has match bytes to give out
+};
+
+void lz_init(struct lz *z, uint8_t *win)
+{
+	z->win = win;
+	memset(win, 0, LZ_WINDOW);
+	z->pos = 0;
+	lz_restart(z);
+}
+
+void lz_restart(struct lz *z)
+{
+	z->step = LZ_TOKEN;
+	z->nflags = 0;
+}
+
+bool lz_wants(const struct lz *z)
+{
+	return(z->step < LZ_LIT);
+}
+
+void lz_feed(struct lz *z, uint8_t in)
+{
+	if (z->step == LZ_LEN)
+	{
+		z->left = in + LZ_MIN_MATCH;
+		z->step = LZ_COPY;
+		return;
+	}
+	if (z->nflags == 0)
+	{
+		z->flags = in;
+		z->nflags = 8;
+		return;
+	}
+	z->nflags--;
+	if (z->flags & 1)
+	{
+		z->from = in;
+		z->step = LZ_LIT;
+	}
+	else
+	{
+		z->from = z->pos - in - 1;		// wraps in the window
+		z->step = LZ_LEN;
+	}
+	z->flags >>= 1;
+}
+
+uint8_t lz_out(struct lz *z)
+{
+	uint8_t ch;
+
+	if (z->step == LZ_LIT)
+	{
+		ch = z->from;
+		z->step = LZ_TOKEN;
+	}
+	else
+	{
+		ch = z->win[z->from++];
+		if (--z->left == 0)
+		{
+			z->step = LZ_TOKEN;
+		}
+	}
+	z->win[z->pos++] = ch;
+	return(ch);
+}
+
+void lz_keep(struct lz *z, uint8_t ch)
+{
+	z->win[z->pos++] = ch;
+}
@@ -0,0 +1,45 @@
+// LZSS unpacking for packed PC uploads (delta_proto.h)
+//
+// The stream is a flag byte then eight items, lowest flag bit first: 1 is
+// a literal byte, 0 a match of two bytes, distance - 1 (1..256 back) then
+// length - 3 (3..258). Matches copy from the last LZ_WINDOW bytes of
+// output, wherever those came from, and may overlap what they write, so a
+// run of one colour is a literal and then one long match one back.
+// Output is pulled a byte at a time, as the display has room, and input
+// only taken when it is needed. Builds on a PC as well, see tools/lzss.
+
+#ifndef LZSS_H_INCLUDED
+#define LZSS_H_INCLUDED
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LZ_WINDOW		256		// so a uint8_t indexes it and wraps
+#define LZ_MIN_MATCH	3
+#define LZ_MAX_MATCH	(LZ_MIN_MATCH + 255)
+
+struct lz {
+	uint8_t *win;					// LZ_WINDOW bytes, the last output
+	uint8_t pos;					// where the next output byte goes
+	uint8_t step;					// see lzss.c
+	uint8_t flags, nflags;			// item flags not used yet
+	uint8_t from;					// match: next byte to copy; literal: the byte
+	uint16_t left;					// match bytes still to copy
+};
+
+void lz_init(struct lz *z, uint8_t *win);	// window all zeros
+void lz_restart(struct lz *z);		// a new stream, keeping the window
+bool lz_wants(const struct lz *z);	// needs a byte in before lz_out()
+void lz_feed(struct lz *z, uint8_t in);
+uint8_t lz_out(struct lz *z);
+void lz_keep(struct lz *z, uint8_t ch);	// output that didn't come out of the stream
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LZSS_H_INCLUDED */
@@ -0,0 +1,51 @@
+// SRAM use and stack high-water mark, see memstat.h
+
+#include <atmel_start.h>
+#include "memstat.h"
+
+extern uint8_t __data_start;
+extern uint8_t __heap_start;		// end of .bss
+extern void *__brkval;				// malloc() top, NULL until first use
+
+void mem_paint(void) __attribute__((naked, used, section(".init1")));
+
+// runs before the stack pointer and r1 are set up, so no C and no calls:
+// fill from the end of .bss up to the top of ram
+void mem_paint(void)
+{
+	__asm__ __volatile__(
+		"	ldi r30, lo8(__heap_start)\n"
+		"	ldi r31, hi8(__heap_start)\n"
+		"	ldi r24, %0\n"
+		"	ldi r25, hi8(%1)\n"
+		"	rjmp 2f\n"
+		"1:	st Z+, r24\n"
+		"2:	cpi r30, lo8(%1)\n"
+		"	cpc r31, r25\n"
+		"	brlo 1b\n"
+		"	breq 1b\n"
+		:: "M" (MEM_PAINT), "i" (RAMEND));
+}
+
+void mem_stat_get(struct mem_stat *m)
+{
+	uint8_t *heaptop, *p, *sp;
+
+	sp = (uint8_t *)SP;
+	heaptop = __brkval ? (uint8_t *)__brkval : &__heap_start;
+
+	m->statics = &__heap_start - &__data_start;
+	m->heap = heaptop - &__heap_start;
+	m->stack_now = (uint8_t *)RAMEND - sp;
+	m->free_now = sp - heaptop;
+
+	// malloc() will have written over some paint, start above it
+	for (p = heaptop; (p < sp) && (*p == MEM_PAINT); p++)
+	;
+	m->free_min = p - heaptop;
+	m->stack_max = (uint8_t *)RAMEND - p + 1;
+	if (m->stack_max < m->stack_now)
+	{
+		m->stack_max = m->stack_now;
+	}
+}
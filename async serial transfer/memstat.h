@@ -0,0 +1,32 @@
+// SRAM use: static data, heap, stack high-water mark and free space
+// The space between the heap and the stack is painted with MEM_PAINT
+// before main() runs, so the deepest the stack has ever been can be found
+// later by looking for the first byte that is no longer paint.
+
+#ifndef MEMSTAT_H_INCLUDED
+#define MEMSTAT_H_INCLUDED
+
+#include <compiler.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MEM_PAINT	0xc5
+
+struct mem_stat {
+	uint16_t statics;		// .data + .bss
+	uint16_t heap;			// malloc() arena in use, 0 if never called
+	uint16_t stack_now;		// bytes of stack in use now
+	uint16_t stack_max;		// deepest it has been since reset
+	uint16_t free_now;		// between heap top and stack pointer
+	uint16_t free_min;		// the part of that gap never touched
+};
+
+void mem_stat_get(struct mem_stat *m);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MEMSTAT_H_INCLUDED */
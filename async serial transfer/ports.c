@@ -0,0 +1,63 @@
+// USART port table, see ports.h
+
+#include <atmel_start.h>
+#include <atomic.h>
+#include "bridge.h"
+#include "ports.h"
+
+const struct port ports[NPORTS] = {
+	{USART_0_is_rx_ready, USART_0_read, USART_0_is_tx_ready, USART_0_write, &UCSR0A, &UCSR0B, &UBRR0H, &UBRR0L},
+	{USART_1_is_rx_ready, USART_1_read, USART_1_is_tx_ready, USART_1_write, &UCSR1A, &UCSR1B, &UBRR1H, &UBRR1L},
+	{USART_2_is_rx_ready, USART_2_read, USART_2_is_tx_ready, USART_2_write, &UCSR2A, &UCSR2B, &UBRR2H, &UBRR2L},
+	{USART_3_is_rx_ready, USART_3_read, USART_3_is_tx_ready, USART_3_write, &UCSR3A, &UCSR3B, &UBRR3H, &UBRR3L},
+};
+
+uint8_t debug_port = PORT_DEBUG;	// moved or turned off by bridges_init()
+
+// Set the baud on the fly. Anything still queued goes out at the old rate
+// first. The control bits are in the same place on every USART.
+void port_set_baud(uint8_t port, uint8_t bindex)
+{
+	const struct port *p = &ports[port];
+	uint16_t ubrr;
+
+	ubrr = baud_ubrr(bindex);
+	while (usart_ring_count(&USART_ring[port][USART_TX]) != 0)
+	;
+	ENTER_CRITICAL(W);
+	while (!(*p->ucsra & (1 << UDRE0)))		// make sure no sneaky isr got in
+	;
+	*p->ucsrb = 0;				// deactivate USART
+	if (baud_u2x(bindex))
+	{
+		*p->ucsra |= (1 << U2X0);
+	}
+	else
+	{
+		*p->ucsra &= ~(1 << U2X0);
+	}
+	*p->ubrrh = ubrr >> 8;
+	*p->ubrrl = ubrr & 0xff;
+	*p->ucsrb = (1 << RXCIE0) | (1 << RXEN0) | (1 << TXEN0);	// activate, UDRE interrupt off
+	EXIT_CRITICAL(W);
+}
+
+// TXC is set when the shift register empties with nothing in UDR. Cleared
+// while the last byte is still queued, it is only set again once that byte
+// is out. FE, DOR and UPE must be written as 0.
+void port_drain_start(uint8_t port)
+{
+	volatile uint8_t *ucsra = ports[port].ucsra;
+
+	*ucsra = (*ucsra & ((1 << U2X0) | (1 << MPCM0))) | (1 << TXC0);
+}
+
+bool port_tx_empty(uint8_t port)
+{
+	return((usart_ring_count(&USART_ring[port][USART_TX]) == 0) && (*ports[port].ucsra & (1 << UDRE0)));
+}
+
+bool port_drained(uint8_t port)
+{
+	return(port_tx_empty(port) && (*ports[port].ucsra & (1 << TXC0)));
+}
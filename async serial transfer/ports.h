@@ -0,0 +1,50 @@
+// USART ports seen through one table, so bridge code can be written once
+// for any pair of ports
+
+#ifndef PORTS_H_INCLUDED
+#define PORTS_H_INCLUDED
+
+#include <compiler.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define NPORTS		4
+
+// what is wired where, by USART number
+#define PORT_PC		0		// PC / Nextion Editor
+#define PORT_LCD	2		// Nextion LCD, more may be added with set lcds
+#define PORT_DEBUG	3		// debug log, telemetry and shell, unless moved
+#define PORT_PC2	1		// second bridge (BRIDGE_DUAL): its PC
+#define PORT_LCD2	3		// and its LCD
+#define PORT_NONE	0xff
+
+struct port {
+	bool (*rx_ready)(void);
+	uint8_t (*read)(void);			// only after rx_ready()
+	bool (*tx_ready)(void);
+	void (*write)(const uint8_t);	// only after tx_ready(), or it waits
+	volatile uint8_t *ucsra;		// registers for port_set_baud()
+	volatile uint8_t *ucsrb;
+	volatile uint8_t *ubrrh;
+	volatile uint8_t *ubrrl;
+};
+
+extern const struct port ports[NPORTS];
+extern uint8_t debug_port;		// where dlog, telemetry and the shell are, or PORT_NONE
+
+void port_set_baud(uint8_t port, uint8_t bindex);	// bindex into the baud table
+
+// For a baud change that doesn't cut the last byte short: port_drain_start()
+// right after the last byte is written, then port_drained() until it is
+// off the wire. Nothing more may be written meanwhile.
+void port_drain_start(uint8_t port);
+bool port_tx_empty(uint8_t port);		// ring and UDR empty, the last byte may still be going
+bool port_drained(uint8_t port);		// and it has gone
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PORTS_H_INCLUDED */
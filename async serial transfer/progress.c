@@ -0,0 +1,184 @@
+// Upload progress, throughput, ETA and LCD ack latency reporting
+// The upload loop only bumps up_sent per byte; everything here runs once
+// per chunk, once per ack, or from idle time.
+
+#include <atmel_start.h>
+#include <string.h>
+#include "bridge.h"
+#include "dlog.h"
+#include "progress.h"
+#include "settings.h"
+
+// The last upload on each bridge. A BRIDGE_DUAL build has no debug port,
+// so this lives in .noinit: it survives a reset, and loading a single
+// bridge build to read it if the loader leaves SRAM alone. The magic word
+// tells it from power on garbage.
+#define UP_KEEP_MAGIC	0x5570
+
+static struct {
+	uint16_t magic;
+	uint8_t boot;					// resets since power on
+	uint8_t valid;					// bit per bridge
+	struct up_record rec[UP_KEEP_RECS];
+} up_keep __attribute__((section(".noinit")));
+
+void progress_init(void)
+{
+	if (up_keep.magic != UP_KEEP_MAGIC)
+	{
+		memset(&up_keep, 0, sizeof up_keep);
+		up_keep.magic = UP_KEEP_MAGIC;
+	}
+	up_keep.boot++;
+}
+
+void progress_start(struct bridge_status *s, uint32_t total, uint32_t baud)
+{
+	s->up_total = total;
+	s->up_sent = 0;
+	s->up_acks = 0;
+	s->up_baud = baud;
+	s->up_start = (uint32_t)msectime();
+	s->up_last = s->up_start;
+	s->chunk_pending = false;
+	s->ack_min = 0xffff;
+	s->ack_max = 0;
+	s->ack_sum = 0;
+	s->ack_n = 0;
+}
+
+void progress_chunk_sent(struct bridge_status *s)
+{
+	s->chunk_end = (uint32_t)msectime();
+	s->chunk_pending = true;
+}
+
+void progress_ack(struct bridge_status *s)
+{
+	uint32_t lat;
+
+	s->up_acks++;
+	if (!s->chunk_pending)		// the ack to whmi-wri itself, no chunk to time
+	{
+		return;
+	}
+	s->chunk_pending = false;
+	lat = (uint32_t)msectime() - s->chunk_end;
+	if (lat > 0xffff)
+	{
+		lat = 0xffff;
+	}
+	if (lat < s->ack_min)
+	{
+		s->ack_min = lat;
+	}
+	if (lat > s->ack_max)
+	{
+		s->ack_max = lat;
+	}
+	s->ack_sum += lat;
+	s->ack_n++;
+}
+
+uint32_t progress_bps(uint32_t bytes, uint32_t ms)
+{
+	if (ms == 0)
+	{
+		return(0);
+	}
+	if (bytes < 4000000UL)		// keep bytes * 1000 inside 32 bits
+	{
+		return(bytes * 1000UL / ms);
+	}
+	return(bytes / ms * 1000UL);
+}
+
+uint32_t progress_rate(const struct bridge_status *s)
+{
+	return(progress_bps(s->up_sent, (uint32_t)msectime() - s->up_start));
+}
+
+static void progress_report(const struct bridge_status *s)
+{
+	uint32_t rate, pct, eta;
+
+	rate = progress_rate(s);
+	pct = 0;
+	eta = 0;
+	if (s->up_total >= 100)
+	{
+		pct = s->up_sent / (s->up_total / 100);
+		if (pct > 100)
+		{
+			pct = 100;
+		}
+	}
+	if ((rate != 0) && (s->up_total > s->up_sent))
+	{
+		eta = (s->up_total - s->up_sent) / rate;
+	}
+	dlog3(DL_UP_PROGRESS, pct, s->up_sent, s->up_total);
+	dlog3(DL_UP_RATE, rate, s->up_baud / 10, eta);		// 10 bits a byte on the line
+}
+
+static void progress_acks(const struct bridge_status *s)
+{
+	if (s->ack_n)
+	{
+		dlog4(DL_UP_ACKS, s->ack_n, s->ack_min, s->ack_sum / s->ack_n, s->ack_max);
+	}
+}
+
+void progress_end(struct bridge_status *s)
+{
+	uint8_t i;
+	uint32_t now;
+
+	now = (uint32_t)msectime();
+	dlog2(DL_UP_DONE, s->up_sent, now - s->up_start);
+	progress_report(s);
+	progress_acks(s);
+
+	i = s->bridge;
+	up_keep.rec[i].start = s->up_start;
+	up_keep.rec[i].end = now;
+	up_keep.rec[i].bytes = s->up_sent;
+	up_keep.rec[i].boot = up_keep.boot;
+	up_keep.valid |= 1 << i;
+}
+
+bool progress_last(uint8_t bridge, struct up_record *r)
+{
+	if ((up_keep.magic != UP_KEEP_MAGIC) || !(up_keep.valid & (1 << bridge)))
+	{
+		return(false);
+	}
+	*r = up_keep.rec[bridge];
+	return(true);
+}
+
+void progress_service(void)
+{
+	struct bridge_status *s;
+	uint32_t now;
+	uint8_t i;
+
+	if (cfg.report_ms == 0)
+	{
+		return;
+	}
+	now = (uint32_t)msectime();
+	for (i = 0; i < NBRIDGES; i++)
+	{
+		s = &bridges[i].st;
+		if ((s->phase != PH_UPLOAD) || (now - s->up_last < cfg.report_ms))
+		{
+			continue;
+		}
+		s->up_last = now;
+		dlog_tag(BRIDGE_TAG(i));
+		progress_report(s);
+		progress_acks(s);
+	}
+	dlog_tag(0);
+}
@@ -0,0 +1,43 @@
+// Upload progress, throughput, ETA and LCD ack latency reporting
+
+#ifndef PROGRESS_H_INCLUDED
+#define PROGRESS_H_INCLUDED
+
+#include <compiler.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define NEX_CHUNK	4096		// the LCD acks every this many bytes with 0x05
+#define NEX_ACK		0x05
+#define UP_BURST	16			// PC to LCD bytes per pass before the ack path is looked at again
+
+struct bridge_status;
+
+void progress_start(struct bridge_status *s, uint32_t total, uint32_t baud);	// whmi-wri accepted
+void progress_chunk_sent(struct bridge_status *s);	// last byte of a chunk went to the LCD, start the ack clock
+void progress_ack(struct bridge_status *s);		// LCD sent 0x05
+void progress_end(struct bridge_status *s);		// upload over, log the summary
+void progress_service(void);	// idle-time: periodic report for each bridge uploading
+uint32_t progress_rate(const struct bridge_status *s);	// effective bytes/sec so far
+
+// the last upload on each bridge, kept across a reset (see progress.c);
+// room for both of a BRIDGE_DUAL build's, whichever build reads them
+#define UP_KEEP_RECS	2
+
+struct up_record {
+	uint32_t start, end;		// msectime() at either end
+	uint32_t bytes;
+	uint8_t boot;				// which run since power on it was in
+};
+
+void progress_init(void);		// once at reset
+bool progress_last(uint8_t bridge, struct up_record *r);	// false if there has been none
+uint32_t progress_bps(uint32_t bytes, uint32_t ms);	// bytes/sec, 0 for no time
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PROGRESS_H_INCLUDED */
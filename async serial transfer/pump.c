@@ -0,0 +1,53 @@
+// Non-blocking direction pump, see pump.h
+// A full ring on the sending side only holds up this direction: the pump
+// counts a stall and returns, so the other direction still gets its turn.
+
+#include <atmel_start.h>
+#include <string.h>
+#include "ports.h"
+#include "pump.h"
+
+void pump_init(struct pump *p, uint8_t from, uint8_t to, uint8_t burst,
+		void (*seen)(void *, uint8_t), void *ctx)
+{
+	memset(p, 0, sizeof *p);
+	p->from = from;
+	p->to = to;
+	p->burst = burst;
+	p->seen = seen;
+	p->ctx = ctx;
+}
+
+uint8_t pump_run(struct pump *p)
+{
+	const struct port *src = &ports[p->from];
+	const struct port *dst = &ports[p->to];
+	uint8_t n, ch, limit;
+
+	limit = p->burst ? p->burst : 255;
+	for (n = 0; src->rx_ready(); n++)
+	{
+		if (n == limit)
+		{
+			p->yields++;		// give the other direction a look in
+			break;
+		}
+		if (!dst->tx_ready())
+		{
+			p->stalls++;		// backpressure, leave it in the rx ring
+			break;
+		}
+		ch = src->read();
+		dst->write(ch);
+		if (p->seen)
+		{
+			p->seen(p->ctx, ch);
+		}
+	}
+	if (n)
+	{
+		p->moved += n;
+		p->runs++;
+	}
+	return(n);
+}
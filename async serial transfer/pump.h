@@ -0,0 +1,32 @@
+// One direction of the bridge: move bytes from one port to another
+// without ever waiting on either of them
+
+#ifndef PUMP_H_INCLUDED
+#define PUMP_H_INCLUDED
+
+#include <compiler.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct pump {
+	uint8_t from, to;				// port numbers, see ports.h
+	uint8_t burst;					// most bytes moved per call, 0 for 255
+	void (*seen)(void *ctx, uint8_t ch);	// called for every byte moved, may be NULL
+	void *ctx;						// passed to seen(), the bridge it belongs to
+	uint32_t moved;					// bytes moved
+	uint32_t stalls;				// calls that found bytes waiting but no room to send them
+	uint32_t yields;				// calls that stopped at the burst limit with more waiting
+	uint32_t runs;					// calls that moved something
+};
+
+void pump_init(struct pump *p, uint8_t from, uint8_t to, uint8_t burst,
+		void (*seen)(void *, uint8_t), void *ctx);
+uint8_t pump_run(struct pump *p);	// returns bytes moved this call
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PUMP_H_INCLUDED */
@@ -0,0 +1,862 @@
+// Standalone flashing from the SD card store or program flash, and delta
+// uploads, see replay.h
+// Only ever runs on bridge 0, whose upload arena holds the sector buffers.
+
+#include <atmel_start.h>
+#include <avr/pgmspace.h>
+#include <stdio.h>
+#include <string.h>
+#include <bridge_config.h>
+#include "arena.h"
+#include "bridge.h"
+#include "crc32.h"
+#include "delta_proto.h"
+#include "dlog.h"
+#include "embedded_tft.h"
+#include "progress.h"
+#include "replay.h"
+#include "settings.h"
+#include "store.h"
+#include "tftcheck.h"
+
+static bool rq_pending;
+static int8_t rq_slot;
+
+void replay_request(int8_t slot)
+{
+	rq_pending = true;
+	rq_slot = slot;
+}
+
+bool replay_requested(int8_t *slot)
+{
+	if (!rq_pending)
+	{
+		return(false);
+	}
+	rq_pending = false;
+	*slot = rq_slot;
+	return(true);
+}
+
+#if TFT_STORE || EMBED_TFT || PACKED_UPLOAD
+
+enum {
+	RS_SUMS,		// delta: reading the PC's chunk CRCs
+	RS_CMD,			// whmi-wri going out at the display's own baud
+	RS_SETTLE,		// its last byte leaving the shift register
+	RS_READY,		// switched, waiting for the first 0x05
+	RS_BACKOFF,		// that baud was not taken, give it a moment before the next
+	RS_SEND,		// streaming a chunk
+	RS_ACK			// waiting for the chunk's 0x05
+};
+
+// why a replay gave up, logged with DL_REPLAY_FAIL and a delta's DLT_END; the
+// numbers are delta_proto.h's, 1 no ack 2 read 3 no baud 4 PC quiet 6 bad pack 8 model
+enum {
+	RF_NOACK = DLT_NOACK,
+	RF_READ = DLT_READ,
+	RF_NOBAUD = DLT_NOBAUD,
+	RF_PCQUIET = DLT_PCQUIET,
+	RF_BADPACK = DLT_BADPACK,
+	RF_MODEL = DLT_MODEL
+};
+
+#define DELTA_HEAD	((TFT_HEAD_LEN < LZ_WINDOW) ? TFT_HEAD_LEN : LZ_WINDOW)	// held in the LZ window
+
+// next_byte() result, else an RF_xxx
+enum {
+	NB_OK = 0,
+	NB_WAIT = 0xff		// for the PC
+};
+
+void replay_poll_button(void)
+{
+#if REPLAY_BUTTON
+	static bool setup, down, fired;
+	static uint32_t since;
+	bool now;
+
+	if (!setup)		// input with pull-up, the button shorts it to ground
+	{
+		DDRA &= ~(1 << PA0);
+		PORTA |= (1 << PA0);
+		setup = true;
+		return;
+	}
+	now = !(PINA & (1 << PA0));
+	if (now != down)
+	{
+		down = now;
+		fired = false;
+		since = (uint32_t)msectime();
+	}
+	else if (down && !fired && ((uint32_t)msectime() - since >= 50))		// held, not bouncing
+	{
+		fired = true;
+		replay_request(-1);
+	}
+#endif
+}
+
+int8_t replay_pick(const char *sig, int8_t slot)
+{
+	char model[TFT_MODEL_LEN];
+	uint_farptr_t at;
+	uint32_t size;
+	bool embedded;
+
+	tft_model(sig, model);
+	embedded = embedded_tft(&at, &size) && embedded_tft_fits(model);
+	if (slot == REPLAY_EMBEDDED)
+	{
+		return(embedded ? slot : -1);
+	}
+	if (slot < 0)		// the last one uploaded, else the built in one
+	{
+#if TFT_STORE
+		slot = tftstore_find(&tft_store, model);
+#endif
+		return(((slot < 0) && embedded) ? REPLAY_EMBEDDED : slot);
+	}
+#if TFT_STORE
+	if ((slot >= TFT_SLOTS) || !tft_store.cat[slot].used ||
+			(strncmp(tft_store.cat[slot].model, model, TFT_MODEL_LEN) != 0))
+	{
+		return(-1);		// not for this display
+	}
+	return(slot);
+#else
+	return(-1);		// no card to have it on
+#endif
+}
+
+// fastest baud in the table below this one, -1 when there are none left
+static int8_t baud_below(uint32_t rate)
+{
+	int8_t i, best;
+
+	best = -1;
+	for (i = 0; i < NBAUDS; i++)
+	{
+		if ((baud_rate(i) < rate) && ((best < 0) || (baud_rate(i) > baud_rate(best))))
+		{
+			best = i;
+		}
+	}
+	return(best);
+}
+
+static void set_timer(struct replay *r, uint16_t ms)
+{
+	r->until = (uint32_t)msectime() + ms;
+}
+
+static bool expired(const struct replay *r)
+{
+	return((int32_t)((uint32_t)msectime() - r->until) >= 0);
+}
+
+static void lcd_send(const struct replay *r, const char *s)
+{
+	while (*s)
+	{
+		ports[r->lcd].write(*s++);		// short, waits for room if it must
+	}
+}
+
+// ask for the upload at the display's own baud, switching to r->bindex after
+static void send_cmd(struct replay *r)
+{
+	char cmd[40];
+
+	port_set_baud(r->lcd, r->found);
+	snprintf_P(cmd, sizeof cmd, PSTR("\xff\xff\xffwhmi-wri %lu,%lu,0\xff\xff\xff"), r->size, baud_rate(r->bindex));
+	lcd_send(r, cmd);
+	r->step = RS_CMD;
+}
+
+static uint32_t now32(void)
+{
+	return((uint32_t)msectime());
+}
+
+// tell nexdelta how it went
+static void delta_end(const struct replay *r, uint8_t status)
+{
+	const struct port *pc = &ports[r->pc];
+
+	pc->write(DLT_END);
+	pc->write(status);
+	pc->write(r->fetched & 0xff);
+	pc->write(r->fetched >> 8);
+}
+
+static uint8_t replay_fail(struct replay *r, uint8_t why)
+{
+	dlog2(DL_REPLAY_FAIL, r->sent, why);
+	if (r->pc != PORT_NONE)
+	{
+		delta_end(r, why);
+		store_capture_end();		// short, so dropped
+	}
+#if TFT_STORE
+	fat_release(&tft_store.vol);
+#endif
+	return(RP_FAILED);
+}
+
+// the stored image in r->slot, its first two sectors ready to go
+static bool open_image(struct replay *r)
+{
+#if TFT_STORE
+	r->bufs[0] = arena.read[0];
+	r->bufs[1] = arena.read[1];
+	if (!tftstore_open(&tft_store, r->slot, false, &r->file, r->bufs[0]))
+	{
+		return(false);
+	}
+	r->len[0] = fat_read_sector(&r->file);
+	r->file.buf = r->bufs[1];
+	r->len[1] = fat_read_sector(&r->file);
+	r->cur = 0;
+	r->pos = 0;
+	r->ahead = false;
+	return(true);
+#else
+	UNUSED(r);
+	return(false);		// replay_pick() gives no slots without a card
+#endif
+}
+
+bool replay_start(struct replay *r, uint8_t lcd, uint8_t found, int8_t slot, struct bridge_status *st)
+{
+	memset(r, 0, sizeof *r);
+	r->lcd = lcd;
+	r->found = found;
+	r->slot = slot;
+	r->st = st;
+	r->pc = PORT_NONE;
+	if (slot == REPLAY_EMBEDDED)
+	{
+		r->far = embedded_tft(&r->base, &r->size);
+	}
+	else
+	{
+		if (!open_image(r))
+		{
+			replay_fail(r, RF_READ);
+			return(false);
+		}
+		r->size = r->file.size;
+	}
+	st->up_total = r->size;
+	r->crc = CRC32_INIT;
+	r->bindex = baud_below(0xffffffffUL);		// the top of the table first
+	dlog2(DL_REPLAY_START, slot, r->size);
+	send_cmd(r);
+	return(true);
+}
+
+bool replay_delta(struct replay *r, uint8_t lcd, uint8_t found, uint8_t pc, const char *sig,
+		uint32_t size, uint32_t baud, uint32_t crc, uint8_t flags, struct bridge_status *st)
+{
+#if TFT_STORE
+	char model[TFT_MODEL_LEN];
+#endif
+#if TFT_CHECK
+	struct lcd_info info;
+#endif
+	int8_t bindex;
+
+	memset(r, 0, sizeof *r);
+	r->lcd = lcd;
+	r->found = found;
+	r->pc = pc;
+	r->sig = sig;
+	r->size = size;
+	r->want = crc;
+	r->chunks = TFT_CHUNKS(size);
+	r->st = st;
+	r->packed = PACKED_UPLOAD && (flags & DLT_PACKED);
+#if TFT_CHECK
+	lcd_info(sig, &info);
+	if (tft_check(&info, size, NULL, 0) == TC_SIZE)
+	{
+		dlog1(DL_TFT_BIG, lcd);
+		delta_end(r, DLT_TOOBIG);
+		return(false);
+	}
+	r->head_len = (size < DELTA_HEAD) ? size : DELTA_HEAD;
+#endif
+#if TFT_STORE
+	tft_model(sig, model);
+	r->slot = tftstore_find(&tft_store, model);
+	r->bufs[0] = arena.read[0];
+	if ((r->slot >= 0) && !tftstore_open(&tft_store, r->slot, true, &r->file, r->bufs[0]))		// the base's chunk CRCs
+	{
+		r->slot = -1;		// stored before there were any
+	}
+#else
+	r->slot = -1;		// no card, no base
+#endif
+	if ((size == 0) || (r->chunks > DLT_MAX_CHUNKS) || ((r->slot < 0) && !r->packed))
+	{
+#if TFT_STORE
+		fat_release(&tft_store.vol);
+#endif
+		ports[pc].write(DLT_NOBASE);
+		dlog0(DL_DELTA_NOBASE);
+		return(false);
+	}
+#if TFT_STORE
+	r->have = (r->slot >= 0) ? tft_store.cat[r->slot].size : 0;		// nothing, so all of it packed
+#endif
+	memset(arena.map, 0, sizeof arena.map);
+	lz_init(&r->lz, arena.lz);
+	bindex = baud_index(baud);
+	r->bindex = (bindex >= 0) ? bindex : baud_below(0xffffffffUL);
+	st->up_total = size;
+	r->crc = CRC32_INIT;
+	r->heard = now32();
+	r->step = RS_SUMS;
+	ports[pc].write(DLT_HELLO);
+	ports[pc].write(TFT_CHUNKS(r->have) & 0xff);
+	ports[pc].write(TFT_CHUNKS(r->have) >> 8);
+	dlog2(DL_DELTA_START, r->slot, r->chunks);
+	return(true);
+}
+
+static uint16_t chunk_len(uint32_t size, uint32_t at)
+{
+	return((size - at < TFT_CHUNK) ? size - at : TFT_CHUNK);
+}
+
+// is the new file's chunk r->chunk, whose CRC is r->sum, the one stored?
+// Called for each chunk in turn, as the base's CRCs are read a sector at a time.
+static bool same_chunk(struct replay *r)
+{
+	const uint8_t *p;
+	uint32_t at;
+	uint16_t i;
+
+	at = (uint32_t)r->chunk * TFT_CHUNK;
+	if (at >= r->have)
+	{
+		return(false);
+	}
+	i = (r->chunk * 4) % BLOCK_SIZE;
+	if (i == 0)
+	{
+		r->len[0] = fat_read_sector(&r->file);
+	}
+	if ((i + 4 > r->len[0]) || (chunk_len(r->size, at) != chunk_len(r->have, at)))
+	{
+		return(false);
+	}
+	p = &r->bufs[0][i];
+	return((p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24)) == r->sum);
+}
+
+// all the CRCs are in: open the base and ask the display for the upload,
+// copying what goes out to another slot
+static uint8_t delta_flash(struct replay *r)
+{
+	dlog2(DL_DELTA_SUMS, r->fetched, r->chunks);
+	r->fetched = 0;
+	r->chunk = 0;
+	if ((r->have > 0) && !open_image(r))
+	{
+		return(replay_fail(r, RF_READ));
+	}
+	store_capture_begin(r->sig, r->size, r->slot);
+	send_cmd(r);
+	return(RP_BUSY);
+}
+
+// the PC's chunk CRCs, marking in the map those not as stored
+static uint8_t replay_sums(struct replay *r)
+{
+	const struct port *pc = &ports[r->pc];
+	uint8_t res;
+
+	res = RP_IDLE;
+	while (pc->rx_ready())
+	{
+		res = RP_BUSY;
+		r->heard = now32();
+		r->sum |= (uint32_t)pc->read() << (8 * r->got);
+		if (++r->got < 4)
+		{
+			continue;
+		}
+		if (!same_chunk(r))
+		{
+			arena.map[r->chunk >> 3] |= 1 << (r->chunk & 7);
+			r->fetched++;
+		}
+		r->sum = 0;
+		r->got = 0;
+		if (++r->chunk == r->chunks)
+		{
+			return(delta_flash(r));
+		}
+	}
+	if (now32() - r->heard > cfg.idle_ms)
+	{
+		return(replay_fail(r, RF_PCQUIET));
+	}
+	return(res);
+}
+
+// the sector after the one going out, into the other buffer if it still
+// wants it; called while the display is busy with what it has been sent
+static void card_ahead(struct replay *r)
+{
+	if (r->ahead)
+	{
+		r->ahead = false;
+		r->file.buf = r->bufs[r->cur ^ 1];
+		r->len[r->cur ^ 1] = fat_read_sector(&r->file);
+	}
+}
+
+// the next byte of the stored image; false if the card ran out before the size said
+static bool card_byte(struct replay *r, uint8_t *ch)
+{
+	if (r->pos == r->len[r->cur])		// this sector is done, the next should have been read ahead
+	{
+		card_ahead(r);		// if not, it has to be now
+		if (r->len[r->cur ^ 1] == 0)
+		{
+			return(false);
+		}
+		r->cur ^= 1;
+		r->pos = 0;
+		r->ahead = true;		// the one just finished gets the sector after
+	}
+	*ch = r->bufs[r->cur][r->pos++];
+	return(true);
+}
+
+// a byte from the PC, waiting for it until it has been quiet too long
+static uint8_t pc_byte(struct replay *r, uint8_t *ch)
+{
+	const struct port *pc = &ports[r->pc];
+
+	if (!pc->rx_ready())
+	{
+		return((now32() - r->heard > cfg.idle_ms) ? RF_PCQUIET : NB_WAIT);
+	}
+	*ch = pc->read();
+	r->heard = now32();
+	return(NB_OK);
+}
+
+// the next of a packed chunk's bytes, asking for more as each DLT_CREDIT
+// of them is used
+static uint8_t packed_in(struct replay *r, uint8_t *ch)
+{
+	uint8_t res;
+
+	if (r->left == 0)		// it needs more than the PC said there was
+	{
+		return(RF_BADPACK);
+	}
+	res = pc_byte(r, ch);
+	if (res != NB_OK)
+	{
+		return(res);
+	}
+	r->left--;
+	if ((++r->taken == DLT_CREDIT) && r->left)
+	{
+		r->taken = 0;
+		ports[r->pc].write(DLT_MORE);
+	}
+	return(NB_OK);
+}
+
+// a changed chunk's next byte when the PC packs them: its packed length
+// first, 0 when it comes as it is, then unpacked as the display has room
+static uint8_t packed_byte(struct replay *r, uint8_t *ch)
+{
+	uint8_t res, in;
+
+	while (r->hdr < 2)
+	{
+		res = pc_byte(r, &in);
+		if (res != NB_OK)
+		{
+			return(res);
+		}
+		r->left |= (uint16_t)in << (8 * r->hdr++);
+		if ((r->hdr == 2) && (r->left == 0))
+		{
+			r->raw = true;
+			r->left = chunk_len(r->size, r->made);
+		}
+	}
+	if (r->raw)
+	{
+		res = packed_in(r, ch);
+		if (res == NB_OK)
+		{
+			lz_keep(&r->lz, *ch);
+		}
+		return(res);
+	}
+	while (lz_wants(&r->lz))
+	{
+		res = packed_in(r, &in);
+		if (res != NB_OK)
+		{
+			return(res);
+		}
+		lz_feed(&r->lz, in);
+	}
+	*ch = lz_out(&r->lz);
+	if (r->left && ((((r->made + 1) & (TFT_CHUNK - 1)) == 0) || (r->made + 1 == r->size)))
+	{
+		return(RF_BADPACK);		// the chunk is all out with some of it not used
+	}
+	return(NB_OK);
+}
+
+// a delta's next byte: from the PC when this chunk changed, asking for it
+// as the chunk starts, else from the card
+static uint8_t delta_byte(struct replay *r, uint8_t *ch)
+{
+	const struct port *pc = &ports[r->pc];
+	uint8_t skip, res;
+
+	if ((uint32_t)r->chunk * TFT_CHUNK == r->made)
+	{
+		r->from_pc = arena.map[r->chunk >> 3] & (1 << (r->chunk & 7));
+		if (r->from_pc)
+		{
+			pc->write(DLT_WANT);
+			pc->write(r->chunk & 0xff);
+			pc->write(r->chunk >> 8);
+			r->fetched++;
+			r->heard = now32();
+			r->hdr = 0;
+			r->left = 0;
+			r->raw = false;
+			r->taken = 0;
+			lz_restart(&r->lz);
+		}
+		r->chunk++;
+	}
+	if (!r->from_pc)
+	{
+		if (!card_byte(r, ch))
+		{
+			return(RF_READ);
+		}
+		lz_keep(&r->lz, *ch);		// the next packed chunk may refer back to it
+		return(NB_OK);
+	}
+	res = r->packed ? packed_byte(r, ch) : pc_byte(r, ch);
+	if (res != NB_OK)
+	{
+		return(res);
+	}
+	if (!r->packed)
+	{
+		lz_keep(&r->lz, *ch);
+	}
+	if ((r->made < r->have) && !card_byte(r, &skip))		// keep the card in step
+	{
+		return(RF_READ);
+	}
+	return(NB_OK);
+}
+
+// the next byte of the image: NB_OK, NB_WAIT or why not
+static uint8_t next_byte(struct replay *r, uint8_t *ch)
+{
+	uint8_t res;
+
+	if (r->far)
+	{
+		*ch = pgm_read_byte_far(r->base + r->made++);
+		return(NB_OK);
+	}
+	if (r->pc != PORT_NONE)
+	{
+		res = delta_byte(r, ch);
+	}
+	else
+	{
+		res = card_byte(r, ch) ? NB_OK : RF_READ;
+	}
+	if (res == NB_OK)
+	{
+		r->crc = crc32_update(r->crc, *ch);		// flash can't go bad on the way, the card and the PC can
+		r->made++;
+	}
+	return(res);
+}
+
+#if TFT_CHECK
+// a delta's start is made before any of it goes out, which leaves it in
+// the LZ window, and the model in its header checked against the display's
+static uint8_t head_check(struct replay *r)
+{
+	struct lcd_info info;
+	uint8_t ch, res, why;
+
+	res = RP_IDLE;
+	while (r->made < r->head_len)
+	{
+		why = next_byte(r, &ch);
+		if (why == NB_WAIT)
+		{
+			return(res);
+		}
+		if (why != NB_OK)
+		{
+			return(replay_fail(r, why));
+		}
+		res = RP_BUSY;
+	}
+	lcd_info(r->sig, &info);
+	if (tft_check(&info, r->size, r->lz.win, r->head_len) != TC_OK)
+	{
+		dlog1(DL_TFT_MODEL, r->lcd);
+		return(replay_fail(r, RF_MODEL));
+	}
+	return(RP_BUSY);
+}
+#endif
+
+// stream what the display has room for up to the end of this chunk
+static uint8_t replay_send(struct replay *r)
+{
+	const struct port *lcd = &ports[r->lcd];
+	uint8_t ch, res, why;
+
+	res = RP_IDLE;
+#if TFT_CHECK
+	if (r->made < r->head_len)
+	{
+		res = head_check(r);
+		if ((res == RP_FAILED) || (r->made < r->head_len))
+		{
+			return(res);
+		}
+	}
+#endif
+	while (lcd->tx_ready())
+	{
+		if (r->sent < r->head_len)
+		{
+			ch = r->lz.win[r->sent];		// checked, from where it was kept
+		}
+		else
+		{
+			why = next_byte(r, &ch);
+			if (why == NB_WAIT)
+			{
+				break;
+			}
+			if (why != NB_OK)
+			{
+				return(replay_fail(r, why));
+			}
+		}
+		lcd->write(ch);
+		if (r->pc != PORT_NONE)
+		{
+			store_capture_put(ch);		// the next delta's base
+		}
+		r->st->up_sent = ++r->sent;
+		res = RP_BUSY;
+		if (((r->sent & (NEX_CHUNK - 1)) == 0) || (r->sent == r->size))
+		{
+			progress_chunk_sent(r->st);
+			set_timer(r, REPLAY_ACK_MS);
+			r->step = RS_ACK;
+			break;
+		}
+	}
+	if (!lcd->tx_ready())
+	{
+		card_ahead(r);		// the display has plenty to be going on with
+	}
+	return(res);
+}
+
+// all acked: check it is what was meant, and for a delta keep the copy
+static uint8_t replay_done(struct replay *r)
+{
+	bool ok;
+
+	if (r->pc != PORT_NONE)
+	{
+		ok = (crc32_final(r->crc) == r->want);
+		delta_end(r, ok ? DLT_OK : DLT_BADCRC);
+		store_capture_end();
+	}
+	else
+	{
+#if TFT_STORE
+		ok = r->far || (crc32_final(r->crc) == tft_store.cat[r->slot].crc);
+#else
+		ok = r->far;
+#endif
+	}
+	dlog1(DL_REPLAY_DONE, ok);
+#if TFT_STORE
+	fat_release(&tft_store.vol);
+#endif
+	return(RP_DONE);
+}
+
+uint8_t replay_run(struct replay *r)
+{
+	const struct port *lcd = &ports[r->lcd];
+	uint8_t ch, res;
+	int8_t next;
+
+	res = RP_IDLE;
+	switch (r->step)
+	{
+	case RS_SUMS:
+		res = replay_sums(r);
+		break;
+
+	case RS_CMD:
+		if (usart_ring_count(&USART_ring[r->lcd][USART_TX]) == 0)
+		{
+			set_timer(r, 10000UL / baud_rate(r->found) + 2);		// a character time and some
+			r->step = RS_SETTLE;
+		}
+		break;
+
+	case RS_SETTLE:
+		if (expired(r))
+		{
+			port_set_baud(r->lcd, r->bindex);
+			set_timer(r, REPLAY_SWITCH_MS);
+			r->step = RS_READY;
+		}
+		break;
+
+	case RS_READY:
+		while (lcd->rx_ready())
+		{
+			res = RP_BUSY;
+			if (lcd->read() == NEX_ACK)
+			{
+				dlog1(DL_REPLAY_BAUD, baud_rate(r->bindex));
+				progress_start(r->st, r->size, baud_rate(r->bindex));
+				r->step = RS_SEND;
+				return(res);
+			}
+		}
+		if (expired(r))
+		{
+			dlog1(DL_REPLAY_NOBAUD, baud_rate(r->bindex));
+			port_set_baud(r->lcd, r->found);
+			set_timer(r, REPLAY_SWITCH_MS);		// let it give up on the upload it half started
+			r->step = RS_BACKOFF;
+		}
+		break;
+
+	case RS_BACKOFF:
+		while (lcd->rx_ready())
+		{
+			lcd->read();
+		}
+		if (expired(r))
+		{
+			next = baud_below(baud_rate(r->bindex));
+			if (next < 0)
+			{
+				return(replay_fail(r, RF_NOBAUD));
+			}
+			r->bindex = next;
+			send_cmd(r);
+			res = RP_BUSY;
+		}
+		break;
+
+	case RS_SEND:
+		res = replay_send(r);
+		break;
+
+	default:		// RS_ACK
+		while (lcd->rx_ready())
+		{
+			res = RP_BUSY;
+			ch = lcd->read();
+			if (ch != NEX_ACK)
+			{
+				continue;
+			}
+			progress_ack(r->st);
+			if (r->sent == r->size)
+			{
+				return(replay_done(r));
+			}
+			r->step = RS_SEND;
+			return(replay_send(r));
+		}
+		if (expired(r))
+		{
+			return(replay_fail(r, RF_NOACK));
+		}
+		card_ahead(r);		// while it writes the chunk to its flash
+		break;
+	}
+	return(res);
+}
+
+#else
+
+void replay_poll_button(void)
+{
+}
+
+int8_t replay_pick(const char *sig, int8_t slot)
+{
+	UNUSED(sig);
+	UNUSED(slot);
+	return(-1);
+}
+
+bool replay_start(struct replay *r, uint8_t lcd, uint8_t found, int8_t slot, struct bridge_status *st)
+{
+	UNUSED(r);
+	UNUSED(lcd);
+	UNUSED(found);
+	UNUSED(slot);
+	UNUSED(st);
+	return(false);
+}
+
+bool replay_delta(struct replay *r, uint8_t lcd, uint8_t found, uint8_t pc, const char *sig,
+		uint32_t size, uint32_t baud, uint32_t crc, uint8_t flags, struct bridge_status *st)
+{
+	UNUSED(r);
+	UNUSED(lcd);
+	UNUSED(found);
+	UNUSED(sig);
+	UNUSED(size);
+	UNUSED(baud);
+	UNUSED(crc);
+	UNUSED(flags);
+	UNUSED(st);
+	ports[pc].write(DLT_NOBASE);		// nothing stored to work from, so all of it
+	return(false);
+}
+
+uint8_t replay_run(struct replay *r)
+{
+	UNUSED(r);
+	return(RP_FAILED);
+}
+
+#endif
@@ -0,0 +1,97 @@
+// Flashing a display with no PC, from the SD card store (TFT_STORE) or
+// the image built into flash (EMBED_TFT)
+//
+// Sends whmi-wri itself at the fastest baud the display takes, starting
+// at the top of the baud table and stepping down when it doesn't ack the
+// switch, then streams the image. From the card the next sector is read
+// into a second buffer while the display is busy, with its TX ring full or
+// writing a chunk before its 0x05, so the stream needn't stop for it; from
+// flash it is read a byte at a time with far addresses as it goes. Either
+// way the stream stops at every 4096 byte chunk until the display acks it.
+//
+// A delta upload (delta_proto.h) is a replay of the display's stored image
+// with the chunks the PC says have changed taken from the PC instead. What
+// goes out is copied back to the card as the display's newest image.
+// Those chunks may come LZSS packed, and are unpacked as the display takes
+// them; with nothing stored every chunk is one of them.
+
+#ifndef REPLAY_H_INCLUDED
+#define REPLAY_H_INCLUDED
+
+#include <compiler.h>
+#include "ports.h"
+#include "fat32.h"
+#include "lzss.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// replay_run() result
+enum {
+	RP_IDLE,			// nothing moved
+	RP_BUSY,			// moved something
+	RP_DONE,			// all of it acked
+	RP_FAILED			// gave up, see the log
+};
+
+#define REPLAY_EMBEDDED		(-2)	// slot number for the image in flash
+
+struct bridge_status;
+
+struct replay {
+	uint8_t lcd;					// port
+	uint8_t found;					// baud index the display was found at
+	uint8_t bindex;					// the one being tried or used
+	uint8_t step;					// see replay.c
+	int8_t slot;					// store slot being sent (a delta's base), or REPLAY_EMBEDDED
+	bool far;						// from program flash, at base
+	uint32_t base;
+	uint32_t until;					// msectime() the current wait gives up
+	uint32_t size, sent;
+	uint32_t made;					// bytes of the image made so far, ahead of sent while a delta's start is checked
+	uint32_t crc;					// of what has been sent
+	struct fat_file file;			// the stored image, or first a delta base's chunk CRCs
+	uint8_t *bufs[2];				// sector double buffer
+	uint16_t len[2];				// bytes in each, 0 past the end of the file
+	uint16_t pos;					// next byte to send from bufs[cur]
+	uint8_t cur;
+	bool ahead;						// bufs[cur ^ 1] still wants the sector after bufs[cur]
+	struct bridge_status *st;		// progress reporting
+
+	// delta upload
+	uint8_t pc;						// port the changed chunks come from, PORT_NONE if not a delta
+	const char *sig;				// the display's comok reply, for the copy kept on the card
+	uint32_t want;					// CRC-32 of the whole new file
+	uint32_t have;					// bytes in the stored image
+	uint16_t chunks;				// in the new file
+	uint16_t chunk;					// being compared, then the next to send
+	uint16_t fetched;				// changed chunks, then those the PC has sent
+	uint32_t sum;					// the PC's CRC being read
+	uint8_t got;					// bytes of it so far
+	bool from_pc;					// the chunk going out now changed
+	uint32_t heard;					// msectime() the PC last sent
+	bool packed;					// the PC packs them
+	bool raw;						// but not this one
+	uint8_t hdr;					// bytes of its packed length read
+	uint16_t left;					// bytes of it still to come
+	uint8_t taken;					// since the last DLT_MORE
+	struct lz lz;					// and every byte out goes in its window
+	uint16_t head_len;				// the start held back until it has been checked (TFT_CHECK)
+};
+
+int8_t replay_pick(const char *sig, int8_t slot);	// the image to send to a display, -1 if none fits
+bool replay_start(struct replay *r, uint8_t lcd, uint8_t found, int8_t slot, struct bridge_status *st);
+bool replay_delta(struct replay *r, uint8_t lcd, uint8_t found, uint8_t pc, const char *sig,
+		uint32_t size, uint32_t baud, uint32_t crc, uint8_t flags, struct bridge_status *st);	// false once the PC is told DLT_NOBASE or DLT_TOOBIG
+uint8_t replay_run(struct replay *r);		// RP_xxx
+
+void replay_request(int8_t slot);			// from the shell or the button, -1 for the newest that fits
+bool replay_requested(int8_t *slot);		// and take the request
+void replay_poll_button(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* REPLAY_H_INCLUDED */
@@ -0,0 +1,71 @@
+// USART ring sizes for each bridge phase
+// Outside an upload the traffic is mostly LCD events going to the host, so
+// USART2 RX and USART0 TX get the space. During an upload nearly all of it
+// is PC to LCD, so USART0 RX does. Sizes are in bytes, powers
+// of 2, and must fit USART_RING_POOL (usart_ring.c halves them if not).
+// USART1 and USART3 keep their reset sizes (usart_basic.h) in every phase,
+// so their rings never move and the debug port never has to drain. The one
+// exception is a broadcast upload with a display on USART1 as well, which
+// shares the space between the two display TX rings instead. Two bridges
+// (BRIDGE_DUAL) get one fixed layout for good.
+
+#include <atmel_start.h>
+#include <avr/pgmspace.h>
+#include "bridge.h"
+#include "delta_proto.h"
+#include "dlog.h"
+#include "ringplan.h"
+
+// USART0 RX in every layout an upload can run under. A packed delta's
+// length and credits all arrive at once, and the bridge may not read them
+// until the display acks the chunk before.
+#define UP_PC_RX	512
+
+_Static_assert(DLT_CREDITS * DLT_CREDIT + 2 <= UP_PC_RX, "packed credits overflow USART0 RX");
+
+// [usart][rx, tx]; no layout takes more than USART_RING_POOL's 1280. The
+// upload stream only needs one deep ring, the PC's RX; USART2 TX is
+// refilled from it as fast as it drains.
+static const uint16_t ring_plan[PH_NPHASES][4][2] PROGMEM = {
+	{{128, 256}, {16, 16}, {256, 128}, {64, 256}},	// PH_FIND
+	{{128, 256}, {16, 16}, {256, 128}, {64, 256}},	// PH_CONNECT
+	{{128, 256}, {16, 16}, {256, 128}, {64, 256}},	// PH_WAITUP
+	{{UP_PC_RX, 64}, {16, 16}, {64, 128}, {64, 256}},	// PH_UPLOAD
+};
+
+static const uint16_t ring_plan_fan[4][2] PROGMEM =
+	{{UP_PC_RX, 64}, {32, 128}, {32, 128}, {64, 256}};	// PH_UPLOAD to several displays
+
+// two bridges, PC to LCD on USART0 to USART2 and USART1 to USART3
+static const uint16_t ring_plan_dual[4][2] PROGMEM =
+	{{UP_PC_RX, 64}, {256, 64}, {64, 128}, {64, 128}};
+
+bool ringplan_apply(uint8_t phase, bool fan)
+{
+	const uint16_t *plan = &ring_plan[phase][0][0];
+
+	if (NBRIDGES > 1)		// set once by ringplan_dual()
+	{
+		return(true);
+	}
+	if ((phase == PH_UPLOAD) && fan)
+	{
+		plan = &ring_plan_fan[0][0];
+	}
+	if (!usart_rings_resize(plan))
+	{
+		dlog1(DL_RING_BUSY, phase);
+		return(false);
+	}
+	return(true);
+}
+
+bool ringplan_dual(void)
+{
+	if (!usart_rings_resize(&ring_plan_dual[0][0]))
+	{
+		dlog1(DL_RING_BUSY, PH_NPHASES);
+		return(false);
+	}
+	return(true);
+}
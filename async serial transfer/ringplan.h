@@ -0,0 +1,25 @@
+// USART ring sizes for each bridge phase
+
+#ifndef RINGPLAN_H_INCLUDED
+#define RINGPLAN_H_INCLUDED
+
+#include <compiler.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// give the ring pool to the rings that are busy in this phase, fan for an
+// upload broadcast to several displays; false (and logged) if the old
+// layout had to stay
+bool ringplan_apply(uint8_t phase, bool fan);
+
+// one layout for two bridges, which are seldom in the same phase;
+// ringplan_apply() leaves it alone from then on
+bool ringplan_dual(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RINGPLAN_H_INCLUDED */
@@ -0,0 +1,270 @@
+// SD card block device, see sd_spi.h
+// A write returns as soon as the card has taken the data; the card's busy
+// time is waited out at the start of the next command instead, so it
+// overlaps with whatever the bridge does in between.
+
+#include <atmel_start.h>
+#include <bridge_config.h>
+#include "bridge.h"
+#include "sd_spi.h"
+
+#if TFT_STORE
+
+#define SD_CS		(1 << PB0)
+#define SD_SCK		(1 << PB1)
+#define SD_MOSI		(1 << PB2)
+
+#define ACMD		0x80		// send CMD55 first
+
+#define CMD0		0			// go idle
+#define CMD8		8			// interface condition, SD v2 only
+#define CMD16		16			// block length, for SDSC
+#define CMD17		17			// read a block
+#define CMD24		24			// write a block
+#define CMD55		55
+#define CMD58		58			// read OCR
+#define ACMD41		(ACMD | 41)	// start initialising
+
+#define SD_INIT_MS	1000		// ACMD41 can take this long
+#define SD_READ_MS	200
+
+static bool sd_blocks;			// SDHC/SDXC: addressed in blocks, not bytes
+static uint16_t sd_wait = SD_BUSY_MS;
+
+static uint8_t spi_xfer(uint8_t out)
+{
+	SPDR = out;
+	while (!(SPSR & (1 << SPIF)))
+	;
+	return(SPDR);
+}
+
+static void sd_deselect(void)
+{
+	PORTB |= SD_CS;
+	spi_xfer(0xff);		// the card lets go of MISO on the next clock
+}
+
+static bool sd_ready(uint16_t ms)
+{
+	uint32_t start;
+
+	start = (uint32_t)msectime();
+	do
+	{
+		if (spi_xfer(0xff) == 0xff)
+		{
+			return(true);
+		}
+	} while ((uint32_t)msectime() - start < ms);
+	return(false);
+}
+
+// send a command, leaving the card selected; its R1 response or 0xff
+static uint8_t sd_cmd(uint8_t cmd, uint32_t arg)
+{
+	uint8_t r, i;
+
+	if (cmd & ACMD)
+	{
+		r = sd_cmd(CMD55, 0);
+		if (r > 1)
+		{
+			return(r);
+		}
+		cmd &= ~ACMD;
+	}
+	sd_deselect();
+	PORTB &= ~SD_CS;
+	if ((cmd != CMD0) && !sd_ready(sd_wait))
+	{
+		return(0xff);
+	}
+	spi_xfer(0x40 | cmd);
+	spi_xfer(arg >> 24);
+	spi_xfer(arg >> 16);
+	spi_xfer(arg >> 8);
+	spi_xfer(arg);
+	spi_xfer((cmd == CMD0) ? 0x95 : (cmd == CMD8) ? 0x87 : 0x01);		// only these two are crc checked
+	for (i = 0; i < 10; i++)
+	{
+		r = spi_xfer(0xff);
+		if (!(r & 0x80))
+		{
+			break;
+		}
+	}
+	return(r);
+}
+
+bool sd_init(void)
+{
+	uint32_t start;
+	uint8_t i, r, ocr[4];
+	bool v2;
+
+	DDRB |= SD_CS | SD_SCK | SD_MOSI;
+	PORTB |= SD_CS;
+	SPCR = (1 << SPE) | (1 << MSTR) | (1 << SPR1) | (1 << SPR0);		// 125kHz until it is going
+	SPSR &= ~(1 << SPI2X);
+	for (i = 0; i < 10; i++)		// at least 74 clocks with CS high
+	{
+		spi_xfer(0xff);
+	}
+
+	r = 0xff;
+	for (i = 0; (i < 10) && (r != 1); i++)
+	{
+		r = sd_cmd(CMD0, 0);
+	}
+	if (r != 1)
+	{
+		sd_deselect();
+		return(false);
+	}
+
+	v2 = false;
+	if (sd_cmd(CMD8, 0x1aa) == 1)
+	{
+		for (i = 0; i < 4; i++)
+		{
+			ocr[i] = spi_xfer(0xff);
+		}
+		if ((ocr[2] != 0x01) || (ocr[3] != 0xaa))		// doesn't do 3.3V
+		{
+			sd_deselect();
+			return(false);
+		}
+		v2 = true;
+	}
+
+	start = (uint32_t)msectime();
+	while ((r = sd_cmd(ACMD41, v2 ? (1UL << 30) : 0)) != 0)
+	{
+		if ((r > 1) || ((uint32_t)msectime() - start > SD_INIT_MS))
+		{
+			sd_deselect();
+			return(false);
+		}
+	}
+
+	sd_blocks = false;
+	if (v2)
+	{
+		if (sd_cmd(CMD58, 0) != 0)
+		{
+			sd_deselect();
+			return(false);
+		}
+		for (i = 0; i < 4; i++)
+		{
+			ocr[i] = spi_xfer(0xff);
+		}
+		sd_blocks = (ocr[0] & 0x40) != 0;		// CCS
+	}
+	if (!sd_blocks && (sd_cmd(CMD16, BLOCK_SIZE) != 0))
+	{
+		sd_deselect();
+		return(false);
+	}
+	sd_deselect();
+
+	SPCR = (1 << SPE) | (1 << MSTR);		// F_CPU/2, 8MHz
+	SPSR |= (1 << SPI2X);
+	return(true);
+}
+
+bool sd_idle(void)
+{
+	bool idle;
+
+	PORTB &= ~SD_CS;
+	idle = (spi_xfer(0xff) == 0xff);
+	sd_deselect();
+	return(idle);
+}
+
+void sd_wait_limit(uint16_t ms)
+{
+	sd_wait = ms;
+}
+
+static bool sd_read(void *ctx, uint32_t lba, uint8_t *buf)
+{
+	uint32_t start;
+	uint16_t i;
+	uint8_t r;
+
+	UNUSED(ctx);
+	if (sd_cmd(CMD17, sd_blocks ? lba : lba * BLOCK_SIZE) != 0)
+	{
+		sd_deselect();
+		return(false);
+	}
+	start = (uint32_t)msectime();
+	while ((r = spi_xfer(0xff)) == 0xff)		// wait for the data token
+	{
+		if ((uint32_t)msectime() - start > SD_READ_MS)
+		{
+			break;
+		}
+	}
+	if (r != 0xfe)
+	{
+		sd_deselect();
+		return(false);
+	}
+	for (i = 0; i < BLOCK_SIZE; i++)
+	{
+		buf[i] = spi_xfer(0xff);
+	}
+	spi_xfer(0xff);		// crc, not checked
+	spi_xfer(0xff);
+	sd_deselect();
+	return(true);
+}
+
+static bool sd_write(void *ctx, uint32_t lba, const uint8_t *buf)
+{
+	uint16_t i;
+	uint8_t r;
+
+	UNUSED(ctx);
+	if (sd_cmd(CMD24, sd_blocks ? lba : lba * BLOCK_SIZE) != 0)
+	{
+		sd_deselect();
+		return(false);
+	}
+	spi_xfer(0xff);
+	spi_xfer(0xfe);		// data token
+	for (i = 0; i < BLOCK_SIZE; i++)
+	{
+		spi_xfer(buf[i]);
+	}
+	spi_xfer(0xff);		// crc, not checked
+	spi_xfer(0xff);
+	r = spi_xfer(0xff) & 0x1f;
+	sd_deselect();
+	return(r == 0x05);		// data accepted; it is written while we get on with something else
+}
+
+const struct blockdev sd_dev = {sd_read, sd_write, NULL};
+
+#else
+
+bool sd_init(void)
+{
+	return(false);
+}
+
+bool sd_idle(void)
+{
+	return(true);
+}
+
+void sd_wait_limit(uint16_t ms)
+{
+	UNUSED(ms);
+}
+
+#endif
@@ -0,0 +1,27 @@
+// SD card in SPI mode on the Mega's SPI port, as a block device
+//
+// SS (PB0, pin 53) is the card's chip select; SCK, MOSI and MISO are
+// PB1..PB3 (pins 52, 51, 50). SDSC, SDHC and SDXC cards are all taken.
+
+#ifndef SD_SPI_H_INCLUDED
+#define SD_SPI_H_INCLUDED
+
+#include <compiler.h>
+#include "blockdev.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SD_BUSY_MS	500				// a write's busy time, worst case
+
+bool sd_init(void);					// false if there is no card or it won't start
+bool sd_idle(void);					// done with the last write, without waiting for it
+void sd_wait_limit(uint16_t ms);	// longest a command waits on the last write, SD_BUSY_MS unless set
+extern const struct blockdev sd_dev;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SD_SPI_H_INCLUDED */
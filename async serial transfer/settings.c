@@ -0,0 +1,78 @@
+// Run time settings, kept in EEPROM and changed from the debug shell
+
+#include <atmel_start.h>
+#include <avr/eeprom.h>
+#include <util/crc16.h>
+#include <string.h>
+#include <bridge_config.h>
+#include "dlog.h"
+#include "ports.h"
+#include "settings.h"
+#include "telemetry.h"
+
+struct settings cfg;
+
+static struct settings EEMEM ee_cfg;
+
+static uint16_t settings_crc(const struct settings *s)
+{
+	const uint8_t *p = (const uint8_t *)s;
+	uint16_t crc = 0xffff;
+	uint8_t i;
+
+	for (i = 0; i < offsetof(struct settings, crc); i++)
+	{
+		crc = _crc_xmodem_update(crc, p[i]);
+	}
+	return(crc);
+}
+
+void settings_defaults(void)
+{
+	memset(&cfg, 0, sizeof cfg);
+	cfg.magic = SET_MAGIC;
+	cfg.version = SET_VERSION;
+	cfg.lcd_baud = 0;
+	cfg.connect_ms = 7000;
+	cfg.upcmd_ms = 5000;
+	cfg.idle_ms = 5000;
+	cfg.report_ms = 2000;
+	cfg.modes = TELEMETRY_DEFAULT_ON ? SET_MODE_TLM : 0;
+	cfg.lcd_ports = 1 << PORT_LCD;
+	cfg.debug_port = PORT_DEBUG;
+	cfg.host2 = PORT_NONE;
+	cfg.arb_prio = ARB_PRIO;
+}
+
+bool settings_stored(void)
+{
+	struct settings s;
+
+	eeprom_read_block(&s, &ee_cfg, sizeof s);
+	return((s.magic == SET_MAGIC) && (s.version == SET_VERSION) && (s.crc == settings_crc(&s)));
+}
+
+bool settings_load(void)
+{
+	if (!settings_stored())
+	{
+		settings_defaults();
+		return(false);
+	}
+	eeprom_read_block(&cfg, &ee_cfg, sizeof cfg);
+	return(true);
+}
+
+void settings_save(void)
+{
+	cfg.magic = SET_MAGIC;
+	cfg.version = SET_VERSION;
+	cfg.crc = settings_crc(&cfg);
+	eeprom_update_block(&cfg, &ee_cfg, sizeof cfg);		// only rewrites bytes that changed
+}
+
+void settings_apply(void)
+{
+	telemetry_enable(cfg.modes & SET_MODE_TLM);
+	dlog_mute(cfg.modes & SET_MODE_QUIET);
+}
@@ -0,0 +1,50 @@
+// Run time settings, kept in EEPROM and changed from the debug shell
+
+#ifndef SETTINGS_H_INCLUDED
+#define SETTINGS_H_INCLUDED
+
+#include <compiler.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SET_MAGIC		0x4e58		// "NX"
+#define SET_VERSION		5
+
+// mode bits
+#define SET_MODE_TLM	0x01		// send binary telemetry frames on USART3
+#define SET_MODE_QUIET	0x02		// no debug text lines on USART3
+
+// USARTs a display may be on; 0 and 3 are the PC and the debug port
+#define SET_LCD_PORTS	((1 << 1) | (1 << 2))
+
+struct settings {
+	uint16_t magic;
+	uint8_t version;
+	uint32_t lcd_baud;			// try this LCD baud first, 0 for none
+	uint16_t connect_ms;		// how long to wait for the Editor to connect
+	uint16_t upcmd_ms;			// how long to wait for whmi-wri per attempt
+	uint16_t idle_ms;			// PC silence that ends an upload
+	uint16_t report_ms;			// upload progress report interval, 0 for none
+	uint8_t modes;				// SET_MODE_xxx
+	uint8_t lcd_ports;			// USARTs with a display on, bit per port
+	uint8_t debug_port;			// USART for the log and shell, 0 for none (from reset)
+	uint8_t host2;				// USART of a second host sharing the LCD, 0 for none (from reset)
+	uint8_t arb_prio;			// control host commands for each one from host2
+	uint16_t crc;				// over everything above
+};
+
+extern struct settings cfg;
+
+void settings_defaults(void);
+bool settings_load(void);		// false if EEPROM was blank or bad, defaults used
+void settings_save(void);
+bool settings_stored(void);		// EEPROM holds a valid copy
+void settings_apply(void);		// push mode bits out to the modules they control
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SETTINGS_H_INCLUDED */
@@ -0,0 +1,685 @@
+// Line oriented command shell on the debug port (USART3 unless moved)
+// Only ever called from idle_tasks(), and never waits for input or output:
+// replies go through the deferred log, long ones a few lines per call.
+
+#include <atmel_start.h>
+#include <avr/pgmspace.h>
+#include <string.h>
+#include <stdlib.h>
+#include <atomic.h>
+#include <bridge_config.h>
+#include "bridge.h"
+#include "discover.h"
+#include "dlog.h"
+#include "lathist.h"
+#include "isrprof.h"
+#include "cpuload.h"
+#include "memstat.h"
+#include "progress.h"
+#include "replay.h"
+#include "settings.h"
+#include "shell.h"
+#include "store.h"
+#include "tftcheck.h"
+#include "timebase.h"
+
+#define SH_LINE_SIZE	40
+#define SH_LOG_SPARE	2		// log slots left for the bridge while dumping
+
+static char sh_line[SH_LINE_SIZE];
+static uint8_t sh_len;
+
+// multi line reply in progress; returns false after its last line
+static bool (*sh_dump)(uint8_t line);
+static uint8_t sh_dumpline;
+
+static bool dump_help(uint8_t line)
+{
+	dlog0(DL_SH_HELP1 + line);
+	return(line < DL_SH_HELP6 - DL_SH_HELP1);
+}
+
+static bool dump_stats(uint8_t line)
+{
+	struct usart_stats st;
+	uint8_t port = line / 3;
+
+	ENTER_CRITICAL(R);
+	st = *(struct usart_stats *)&USART_stats[port];
+	EXIT_CRITICAL(R);
+	switch (line % 3)
+	{
+	case 0:
+		dlog4(DL_SH_PORT1, port, st.rx_bytes, st.tx_bytes, st.rx_overflows);
+		break;
+	case 1:
+		dlog4(DL_SH_PORT2, port, st.rx_errors, st.rx_hwm, st.tx_hwm);
+		break;
+	default:
+		dlog3(DL_SH_PORT3, port, usart_ring_size(port, USART_RX), usart_ring_size(port, USART_TX));
+		break;
+	}
+	return(line < 11);
+}
+
+static bool dump_up(uint8_t line)
+{
+	const struct bridge_status *bstat = &bridges[0].st;
+	uint32_t avg;
+
+	if (line == 0)
+	{
+		dlog3(DL_UP_PROGRESS, (bstat->up_total >= 100) ? bstat->up_sent / (bstat->up_total / 100) : 0,
+				bstat->up_sent, bstat->up_total);
+		return(true);
+	}
+	avg = bstat->ack_n ? bstat->ack_sum / bstat->ack_n : 0;
+	dlog4(DL_UP_ACKS, bstat->ack_n, bstat->ack_n ? bstat->ack_min : 0, avg, bstat->ack_max);
+	return(false);
+}
+
+// how long the last run of each phase took
+static bool dump_times(uint8_t line)
+{
+	const uint32_t *ms = bridges[0].st.phase_ms;
+
+	if (line == 0)
+	{
+		dlog2(DL_SH_TIMES1, ms[PH_FIND], ms[PH_CONNECT]);
+		return(true);
+	}
+	dlog2(DL_SH_TIMES2, ms[PH_WAITUP], ms[PH_UPLOAD]);
+	return(false);
+}
+
+static bool dump_show(uint8_t line)
+{
+	if (line == 0)
+	{
+		dlog3(DL_SH_CFG1, cfg.lcd_baud, cfg.connect_ms, cfg.upcmd_ms);
+		return(true);
+	}
+	if (line == 1)
+	{
+		dlog4(DL_SH_CFG2, cfg.idle_ms, cfg.report_ms, cfg.lcd_ports, settings_stored());
+		return(true);
+	}
+	if (line == 2)
+	{
+		dlog1(DL_SH_CFGMODE, cfg.modes);
+		return(true);
+	}
+	dlog4(DL_SH_CFG3, (cfg.debug_port < NPORTS) ? cfg.debug_port : 0, (cfg.host2 < NPORTS) ? cfg.host2 : 0,
+			cfg.arb_prio, NBRIDGES);
+	return(false);
+}
+
+// forwarding latency, only the bins that have counts
+static bool dump_hist(uint8_t line)
+{
+	uint8_t dir, bin;
+	uint16_t n;
+
+	if (line == 0)
+	{
+		dlog1(DL_SH_HIST, LATENCY_HIST);
+		return(LATENCY_HIST);
+	}
+	line--;
+	dir = line / LAT_BINS;
+	bin = line % LAT_BINS;
+	n = lat_count(dir, bin);
+	if (n)
+	{
+		dlog3(DL_SH_HISTBIN, dir, (LAT_TICK_US * 2UL) << bin, n);
+	}
+	return(line < LAT_NDIRS * LAT_BINS - 1);
+}
+
+// ISR cycle costs, two lines for each vector that has run
+static bool dump_prof(uint8_t line)
+{
+	struct isr_prof p;
+	uint32_t baud;
+
+	if (line == 0)
+	{
+		dlog1(DL_SH_PROF, PROFILE_ISR);
+		return(PROFILE_ISR);
+	}
+	if (line == 1)
+	{
+		dlog0(DL_SH_PROF2);
+		return(true);
+	}
+	if (line == 2)		// the budget all the ISRs for one byte have to fit in
+	{
+		baud = bridges[0].st.up_baud ? bridges[0].st.up_baud : 115200;
+		dlog2(DL_SH_PROFBYTE, F_CPU / (baud / 10), baud);
+		return(true);
+	}
+	line -= 3;
+	if (isr_prof_get(line >> 1, &p))
+	{
+		if (line & 1)
+		{
+			dlog2(DL_SH_PROFCNT, line >> 1, p.count);
+		}
+		else
+		{
+			dlog4(DL_SH_PROFVEC, line >> 1, p.min, p.total / p.count, p.max);
+		}
+	}
+	return(line < PV_N * 2 - 1);
+}
+
+static void show_load(void)
+{
+	struct cpu_load l;
+
+	if (cpuload_get(&l))
+	{
+		dlog4(DL_SH_LOAD, l.isr_pct, l.work_pct, l.idle_pct, l.loops);
+	}
+	else
+	{
+		dlog0(DL_SH_NOTBUILT);
+	}
+}
+
+static void show_mem(void)
+{
+	struct mem_stat m;
+
+	mem_stat_get(&m);
+	dlog3(DL_SH_MEM1, m.statics, m.heap, m.free_now);
+	dlog3(DL_SH_MEM2, m.stack_now, m.stack_max, m.free_min);
+}
+
+// upload loop direction counters
+static bool dump_pumps(uint8_t line)
+{
+	struct pump *p;
+
+	if (line == 0)
+	{
+		dlog0(DL_SH_PUMPS);
+		return(true);
+	}
+	p = &bridges[0].pumps[line - 1];
+	dlog4(DL_SH_PUMP, line - 1, p->moved, p->stalls, p->yields);
+	return(line < UP_NPUMPS);
+}
+
+// displays found, then the discovery table: baud and reply for each port
+static bool dump_lcds(uint8_t line)
+{
+	const struct lcd_entry *e;
+	struct lcd_info info;
+
+	if (line == 0)
+	{
+		dlog3(DL_SH_LCDS, bridges[0].lcds.live, bridges[0].lcds.primary, bridges[0].lcds.failed);
+		return(true);
+	}
+	e = &lcd_table[line - 1];
+	if (e->bindex >= 0)
+	{
+		lcd_info(e->sig, &info);
+		dlog4(DL_SH_LCDTAB, line - 1, baud_rate(e->bindex), info.firmware, info.flash);
+	}
+	return(line < NPORTS);
+}
+
+// the shared LCD: who has sent what, and where its frames went
+static bool dump_arb(uint8_t line)
+{
+	const struct bridge *b = &bridges[0];
+
+	if (line == 0)
+	{
+		dlog4(DL_SH_ARB, (b->host2 < NPORTS) ? b->host2 : 0, b->arb.prio, b->arb.owner, b->arb.cut);
+		return(b->host2 < NPORTS);
+	}
+	if (line <= ARB_HOSTS)
+	{
+		dlog3(DL_SH_ARBHOST, line - 1, b->arb.hosts[line - 1], b->arb.frames[line - 1]);
+		return(true);
+	}
+	dlog2(DL_SH_ARBLCD, b->arb.replies, b->arb.events);
+	return(false);
+}
+
+// the SD card's image catalogue, empty slots left out
+static bool dump_store(uint8_t line)
+{
+#if TFT_STORE
+	const struct tft_entry *e;
+
+	if (line == 0)
+	{
+		dlog2(DL_SH_STOREHDR, tft_store.mounted, tft_store.slot);
+		return(tft_store.mounted);
+	}
+	e = &tft_store.cat[line - 1];
+	if (e->used)
+	{
+		dlog4(DL_SH_STORE, line - 1, e->seq, e->size, e->crc);
+	}
+	return(line < TFT_SLOTS);
+#else
+	UNUSED(line);
+	dlog0(DL_SH_NOTBUILT);
+	return(false);
+#endif
+}
+
+// the last upload on each bridge, and the two together when they were
+// in the same run (dual mode); kept over the reset needed to read them
+static bool dump_rate(uint8_t line)
+{
+	struct up_record r[UP_KEEP_RECS];
+	uint32_t start, end, bytes;
+	uint8_t i;
+
+	if (line < UP_KEEP_RECS)
+	{
+		if (progress_last(line, &r[0]))
+		{
+			dlog4(DL_SH_RATE, line, r[0].bytes, r[0].end - r[0].start,
+					progress_bps(r[0].bytes, r[0].end - r[0].start));
+		}
+		return(true);
+	}
+	for (i = 0; i < UP_KEEP_RECS; i++)
+	{
+		if (!progress_last(i, &r[i]) || (r[i].boot != r[0].boot))
+		{
+			return(false);
+		}
+	}
+	start = r[0].start;
+	end = r[0].end;
+	bytes = 0;
+	for (i = 0; i < UP_KEEP_RECS; i++)		// from the first start to the last end
+	{
+		if ((int32_t)(r[i].start - start) < 0)
+		{
+			start = r[i].start;
+		}
+		if ((int32_t)(r[i].end - end) > 0)
+		{
+			end = r[i].end;
+		}
+		bytes += r[i].bytes;
+	}
+	dlog3(DL_SH_RATEALL, bytes, end - start, progress_bps(bytes, end - start));
+	return(false);
+}
+
+// check what can be checked without disturbing the bridge
+static void selftest(void)
+{
+	uint16_t t0;
+	uint8_t i, tries, ok;
+	uint32_t actual, want;
+
+	// timer 5 runs at the cpu clock so it must move between two reads
+	t0 = tcnt5();
+	for (tries = 0; (tries < 10) && (tcnt5() == t0); tries++)
+	;
+
+	// every baud table entry has to give a rate within 3% of its label
+	ok = 1;
+	for (i = 0; i < NBAUDS; i++)
+	{
+		want = baud_rate(i);
+		actual = F_CPU / ((baud_u2x(i) ? 8UL : 16UL) * (baud_ubrr(i) + 1));
+		if ((actual > want + want / 33) || (actual < want - want / 33))
+		{
+			ok = 0;
+		}
+	}
+	dlog3(DL_SH_SELFTEST, tries < 10, ok, settings_stored());
+}
+
+// cost in cycles of the calls the upload loop makes every pass, best of 16
+static void bench(void)
+{
+	uint16_t t0, t1, best[4];
+	uint8_t i;
+
+	memset(best, 0xff, sizeof best);
+	for (i = 0; i < 16; i++)
+	{
+		t0 = tcnt5();
+		USART_0_is_rx_ready();
+		t1 = tcnt5();
+		if (t1 - t0 < best[0])
+			best[0] = t1 - t0;
+
+		t0 = tcnt5();
+		USART_2_is_tx_ready();
+		t1 = tcnt5();
+		if (t1 - t0 < best[1])
+			best[1] = t1 - t0;
+
+		t0 = tcnt5();
+		msectime();
+		t1 = tcnt5();
+		if (t1 - t0 < best[2])
+			best[2] = t1 - t0;
+
+		t0 = tcnt5();
+		tcnt5();
+		t1 = tcnt5();
+		if (t1 - t0 < best[3])
+			best[3] = t1 - t0;		// the cost of the measurement itself
+	}
+	dlog4(DL_SH_BENCH, best[0] - best[3], best[1] - best[3], best[2] - best[3], best[3]);
+}
+
+static bool getnum(const char *s, uint32_t *v)
+{
+	char *end;
+
+	if (s == NULL)
+	{
+		return(false);
+	}
+	*v = strtoul(s, &end, 10);
+	return((end != s) && (*end == '\0'));
+}
+
+static void do_set(char *what, char *val)
+{
+	uint32_t v;
+	uint16_t *field = NULL;
+
+	if ((what == NULL) || !getnum(val, &v))
+	{
+		dlog0(DL_SH_BADVAL);
+		return;
+	}
+	if (strcmp_P(what, PSTR("baud")) == 0)
+	{
+		if ((v != 0) && (baud_index(v) < 0))		// only rates we have a divisor for
+		{
+			dlog0(DL_SH_BADVAL);
+			return;
+		}
+		cfg.lcd_baud = v;
+	}
+	else if (strcmp_P(what, PSTR("mode")) == 0)
+	{
+		cfg.modes = v;
+		settings_apply();
+	}
+	else if (strcmp_P(what, PSTR("lcds")) == 0)
+	{
+		if ((v == 0) || (v & ~SET_LCD_PORTS))		// a bit per USART, only 1 and 2 can have one
+		{
+			dlog0(DL_SH_BADVAL);
+			return;
+		}
+		cfg.lcd_ports = v;		// used from the next display search
+	}
+	else if (strcmp_P(what, PSTR("debug")) == 0)
+	{
+		if ((v >= NPORTS) || (v == PORT_PC))		// 0 turns it off, the PC is always on USART0
+		{
+			dlog0(DL_SH_BADVAL);
+			return;
+		}
+		cfg.debug_port = v ? v : PORT_NONE;		// from the next reset, once saved
+	}
+	else if (strcmp_P(what, PSTR("host2")) == 0)
+	{
+		if ((v >= NPORTS) || (v == PORT_PC))		// 0 for none, it can't be the control host
+		{
+			dlog0(DL_SH_BADVAL);
+			return;
+		}
+		cfg.host2 = v ? v : PORT_NONE;		// from the next reset, once saved
+	}
+	else if (strcmp_P(what, PSTR("prio")) == 0)
+	{
+		if ((v == 0) || (v > 255))
+		{
+			dlog0(DL_SH_BADVAL);
+			return;
+		}
+		cfg.arb_prio = v;		// from the next wait for an upload
+	}
+	else
+	{
+		if (strcmp_P(what, PSTR("connect")) == 0)
+		{
+			field = &cfg.connect_ms;
+		}
+		else if (strcmp_P(what, PSTR("upcmd")) == 0)
+		{
+			field = &cfg.upcmd_ms;
+		}
+		else if (strcmp_P(what, PSTR("idle")) == 0)
+		{
+			field = &cfg.idle_ms;
+		}
+		else if (strcmp_P(what, PSTR("report")) == 0)
+		{
+			field = &cfg.report_ms;
+		}
+		// only the report interval may be 0, which turns reports off
+		if ((field == NULL) || (v > 60000) || ((v == 0) && (field != &cfg.report_ms)))
+		{
+			dlog0(DL_SH_BADVAL);
+			return;
+		}
+		*field = v;
+	}
+	dlog0(DL_SH_OK);
+}
+
+// CRC-32 in hex and size of the file the next upload should deliver, as
+// a host tool worked them out; nothing to forget them
+static void expect(char *crc, char *size)
+{
+	struct bridge *b = &bridges[0];
+	char *end;
+	uint32_t v;
+
+	if (crc == NULL)
+	{
+		b->expecting = false;
+		dlog0(DL_SH_OK);
+		return;
+	}
+	v = strtoul(crc, &end, 16);
+	if ((end == crc) || (*end != '\0') || !getnum(size, &b->expect_size))
+	{
+		dlog0(DL_SH_BADVAL);
+		return;
+	}
+	b->expect_crc = v;
+	b->expecting = true;
+	dlog0(DL_SH_OK);
+}
+
+static void sh_exec(void)
+{
+	char *cmd, *a1, *a2;
+	uint32_t v;
+
+	cmd = strtok(sh_line, " ");
+	if (cmd == NULL)
+	{
+		return;
+	}
+	a1 = strtok(NULL, " ");
+	a2 = strtok(NULL, " ");
+
+	if (strcmp_P(cmd, PSTR("help")) == 0)
+	{
+		sh_dump = dump_help;
+	}
+	else if (strcmp_P(cmd, PSTR("stats")) == 0)
+	{
+		sh_dump = dump_stats;
+	}
+	else if (strcmp_P(cmd, PSTR("clear")) == 0)
+	{
+		ENTER_CRITICAL(W);
+		memset((void *)USART_stats, 0, sizeof USART_stats);
+		EXIT_CRITICAL(W);
+		lat_clear();
+		isr_prof_clear();
+		dlog0(DL_SH_OK);
+	}
+	else if (strcmp_P(cmd, PSTR("times")) == 0)
+	{
+		sh_dump = dump_times;
+	}
+	else if (strcmp_P(cmd, PSTR("up")) == 0)
+	{
+		sh_dump = dump_up;
+	}
+	else if (strcmp_P(cmd, PSTR("show")) == 0)
+	{
+		sh_dump = dump_show;
+	}
+	else if (strcmp_P(cmd, PSTR("set")) == 0)
+	{
+		do_set(a1, a2);
+	}
+	else if (strcmp_P(cmd, PSTR("save")) == 0)
+	{
+		settings_save();
+		dlog0(DL_SH_OK);
+	}
+	else if (strcmp_P(cmd, PSTR("load")) == 0)
+	{
+		dlog0(settings_load() ? DL_SH_OK : DL_SH_BADVAL);
+		settings_apply();
+	}
+	else if (strcmp_P(cmd, PSTR("defaults")) == 0)
+	{
+		settings_defaults();
+		settings_apply();
+		dlog0(DL_SH_OK);
+	}
+	else if (strcmp_P(cmd, PSTR("selftest")) == 0)
+	{
+		selftest();
+	}
+	else if (strcmp_P(cmd, PSTR("bench")) == 0)
+	{
+		bench();
+	}
+	else if (strcmp_P(cmd, PSTR("hist")) == 0)
+	{
+		sh_dump = dump_hist;
+	}
+	else if (strcmp_P(cmd, PSTR("prof")) == 0)
+	{
+		sh_dump = dump_prof;
+	}
+	else if (strcmp_P(cmd, PSTR("cpu")) == 0)
+	{
+		show_load();
+	}
+	else if (strcmp_P(cmd, PSTR("mem")) == 0)
+	{
+		show_mem();
+	}
+	else if (strcmp_P(cmd, PSTR("pumps")) == 0)
+	{
+		sh_dump = dump_pumps;
+	}
+	else if (strcmp_P(cmd, PSTR("rate")) == 0)
+	{
+		sh_dump = dump_rate;
+	}
+	else if (strcmp_P(cmd, PSTR("lcds")) == 0)
+	{
+		sh_dump = dump_lcds;
+	}
+	else if (strcmp_P(cmd, PSTR("arb")) == 0)
+	{
+		sh_dump = dump_arb;
+	}
+	else if (strcmp_P(cmd, PSTR("store")) == 0)
+	{
+		sh_dump = dump_store;
+	}
+	else if (strcmp_P(cmd, PSTR("expect")) == 0)		// [crc size], checked when the next upload ends
+	{
+		expect(a1, a2);
+	}
+	else if (strcmp_P(cmd, PSTR("flash")) == 0)		// [slot|rom], once a display is found
+	{
+		if (!TFT_STORE && !EMBED_TFT)
+		{
+			dlog0(DL_SH_NOTBUILT);
+		}
+		else if ((a1 != NULL) && (strcmp_P(a1, PSTR("rom")) == 0))
+		{
+			replay_request(REPLAY_EMBEDDED);
+			dlog0(DL_SH_OK);
+		}
+		else if ((a1 != NULL) && (!getnum(a1, &v) || (v >= TFT_SLOTS)))
+		{
+			dlog0(DL_SH_BADVAL);
+		}
+		else
+		{
+			replay_request((a1 != NULL) ? (int8_t)v : -1);
+			dlog0(DL_SH_OK);
+		}
+	}
+	else
+	{
+		dlog0(DL_SHELL);
+	}
+	sh_dumpline = 0;
+}
+
+void shell_service(void)
+{
+	uint8_t ch;
+
+	// keep a long reply going while the log has room for it
+	while (sh_dump && (dlog_free() > SH_LOG_SPARE))
+	{
+		if (!sh_dump(sh_dumpline++))
+		{
+			sh_dump = NULL;
+		}
+	}
+	if (sh_dump || (debug_port == PORT_NONE))
+	{
+		return;		// one command at a time, input waits in the ring
+	}
+
+	while (ports[debug_port].rx_ready())
+	{
+		ch = ports[debug_port].read();
+		if ((ch == '\r') || (ch == '\n'))
+		{
+			sh_line[sh_len] = '\0';
+			sh_len = 0;
+			sh_exec();
+			return;		// run at most one command per idle slot
+		}
+		if ((ch == 0x08) || (ch == 0x7f))
+		{
+			if (sh_len)
+			{
+				sh_len--;
+			}
+		}
+		else if ((sh_len < sizeof sh_line - 1) && (ch >= ' '))
+		{
+			sh_line[sh_len++] = ch;
+		}
+	}
+}
@@ -0,0 +1,20 @@
+// Line oriented command shell on the debug USART (USART3)
+
+#ifndef SHELL_H_INCLUDED
+#define SHELL_H_INCLUDED
+
+#include <compiler.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// idle-time only: take what has arrived on USART3, run complete lines
+// and feed long replies into the debug log a few lines at a time
+void shell_service(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SHELL_H_INCLUDED */
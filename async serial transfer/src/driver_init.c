@@ -188,6 +188,8 @@ void system_init()
 
 	TIMER_3_initialization();
 
+	usart_rings_init();
+
 	USART_0_initialization();
 
 	USART_1_initialization();
@@ -46,68 +46,93 @@
 #include <clock_config.h>
 #include <usart_basic.h>
 #include <atomic.h>
+#include "lathist.h"
+#include "isrprof.h"
 
-/* Static Variables holding the ringbuffer used in IRQ mode */
-static uint8_t          USART_0_rxbuf[USART_0_RX_BUFFER_SIZE];
-static volatile uint8_t USART_0_rx_head;
-static volatile uint8_t USART_0_rx_tail;
-static volatile uint8_t USART_0_rx_elements;
-static uint8_t          USART_0_txbuf[USART_0_TX_BUFFER_SIZE];
-static volatile uint8_t USART_0_tx_head;
-static volatile uint8_t USART_0_tx_tail;
-static volatile uint8_t USART_0_tx_elements;
+/* Traffic and error counters for USART_0..3, updated from the ISRs */
+volatile struct usart_stats USART_stats[4];
 
+/* USART_0 rings, carved out of the pool by usart_rings_init() */
+#define USART_0_rx USART_ring[0][USART_RX]
+#define USART_0_tx USART_ring[0][USART_TX]
+
+#if !USART_ASM_ISR	/* else see usart_relay.S */
 /* Interrupt service routine for RX complete */
 ISR(USART0_RX_vect)
 {
-	uint8_t data;
-	uint8_t tmphead;
+	uint8_t  data;
+	uint16_t tmphead;
+	uint8_t  status;
+	PROF_ENTER();
 
+	/* Read the error flags first, reading UDR clears them */
+	status = UCSR0A;
 	/* Read the received data */
 	data = UDR0;
-	/* Calculate buffer index */
-	tmphead = (USART_0_rx_head + 1) & USART_0_RX_BUFFER_MASK;
-	/* Store new index */
-	USART_0_rx_head = tmphead;
+	if (status & ((1 << FE0) | (1 << DOR0) | (1 << UPE0))) {
+		USART_stats[0].rx_errors++;
+	}
+	USART_stats[0].rx_bytes++;
 
-	if (tmphead == USART_0_rx_tail) {
-		/* ERROR! Receive buffer overflow */
+	if (USART_0_rx.elements > USART_0_rx.mask) {
+		/* ERROR! Receive buffer overflow, the byte is dropped */
+		USART_stats[0].rx_overflows++;
+	} else {
+		/* Calculate buffer index */
+		tmphead = (USART_0_rx.head + 1) & USART_0_rx.mask;
+		/* Store new index */
+		USART_0_rx.head = tmphead;
+		/* Store received data in buffer */
+		USART_0_rx.buf[tmphead] = data;
+#if LATENCY_HIST
+		USART_0_rx.stamp[tmphead] = lat_ticks();
+#endif
+		USART_0_rx.elements++;
+		if (USART_0_rx.elements > USART_stats[0].rx_hwm) {
+			USART_stats[0].rx_hwm = USART_0_rx.elements;
+		}
 	}
-	/* Store received data in buffer */
-	USART_0_rxbuf[tmphead] = data;
-	USART_0_rx_elements++;
+	PROF_EXIT(PV_U0RX);
 }
 
 /* Interrupt service routine for Data Register Empty */
 ISR(USART0_UDRE_vect)
 {
-	uint8_t tmptail;
+	uint16_t tmptail;
+	PROF_ENTER();
 
 	/* Check if all data is transmitted */
-	if (USART_0_tx_elements != 0) {
+	if (USART_0_tx.elements != 0) {
 		/* Calculate buffer index */
-		tmptail = (USART_0_tx_tail + 1) & USART_0_TX_BUFFER_MASK;
+		tmptail = (USART_0_tx.tail + 1) & USART_0_tx.mask;
 		/* Store new index */
-		USART_0_tx_tail = tmptail;
+		USART_0_tx.tail = tmptail;
 		/* Start transmission */
-		UDR0 = USART_0_txbuf[tmptail];
-		USART_0_tx_elements--;
+		UDR0 = USART_0_tx.buf[tmptail];
+#if LATENCY_HIST
+		lat_record(LAT_LCD2PC, USART_0_tx.stamp[tmptail]);
+#endif
+		USART_0_tx.elements--;
+		USART_stats[0].tx_bytes++;
 	}
 
-	if (USART_0_tx_elements == 0) {
+	if (USART_0_tx.elements == 0) {
 		/* Disable UDRE interrupt */
 		UCSR0B &= ~(1 << UDRIE0);
 	}
+	PROF_EXIT(PV_U0UDRE);
 }
 
+#endif /* !USART_ASM_ISR */
+
 bool USART_0_is_tx_ready()
 {
-	return (USART_0_tx_elements != USART_0_TX_BUFFER_SIZE);
+	return (USART_0_tx_count() <= USART_0_tx.mask);
 }
 
 bool USART_0_is_rx_ready()
 {
-	return (USART_0_rx_elements != 0);
+	return (USART_0_rx_count() != 0);
 }
 
 bool USART_0_is_tx_busy()
@@ -115,40 +140,62 @@ bool USART_0_is_tx_busy()
 	return (!(UCSR0A & (1 << TXC0)));
 }
 
+uint16_t USART_0_rx_count()
+{
+	return usart_ring_count(&USART_0_rx);
+}
+
+uint16_t USART_0_tx_count()
+{
+	return usart_ring_count(&USART_0_tx);
+}
+
 uint8_t USART_0_read(void)
 {
-	uint8_t tmptail;
+	uint16_t tmptail;
+	uint8_t  data;
 
 	/* Wait for incoming data */
-	while (USART_0_rx_elements == 0)
+	while (!USART_0_is_rx_ready())
 		;
 	/* Calculate buffer index */
-	tmptail = (USART_0_rx_tail + 1) & USART_0_RX_BUFFER_MASK;
+	tmptail = (USART_0_rx.tail + 1) & USART_0_rx.mask;
+	/* Take the data before the slot is handed back to the ISR */
+	data = USART_0_rx.buf[tmptail];
+#if LATENCY_HIST
+	lat_stamp[LAT_PC2LCD] = USART_0_rx.stamp[tmptail];
+#endif
 	/* Store new index */
-	USART_0_rx_tail = tmptail;
+	USART_0_rx.tail = tmptail;
 	ENTER_CRITICAL(R);
-	USART_0_rx_elements--;
+	USART_0_rx.elements--;
 	EXIT_CRITICAL(R);
 
 	/* Return data */
-	return USART_0_rxbuf[tmptail];
+	return data;
 }
 
 void USART_0_write(const uint8_t data)
 {
-	uint8_t tmphead;
+	uint16_t tmphead;
 
-	/* Calculate buffer index */
-	tmphead = (USART_0_tx_head + 1) & USART_0_TX_BUFFER_MASK;
 	/* Wait for free space in buffer */
-	while (USART_0_tx_elements == USART_0_TX_BUFFER_SIZE)
+	while (!USART_0_is_tx_ready())
 		;
+	/* Calculate buffer index */
+	tmphead = (USART_0_tx.head + 1) & USART_0_tx.mask;
 	/* Store data in buffer */
-	USART_0_txbuf[tmphead] = data;
+	USART_0_tx.buf[tmphead] = data;
+#if LATENCY_HIST
+	USART_0_tx.stamp[tmphead] = lat_stamp[LAT_LCD2PC];
+#endif
 	/* Store new index */
-	USART_0_tx_head = tmphead;
+	USART_0_tx.head = tmphead;
 	ENTER_CRITICAL(W);
-	USART_0_tx_elements++;
+	USART_0_tx.elements++;
+	if (USART_0_tx.elements > USART_stats[0].tx_hwm) {
+		USART_stats[0].tx_hwm = USART_0_tx.elements;
+	}
 	EXIT_CRITICAL(W);
 	/* Enable UDRE interrupt */
 	UCSR0B |= (1 << UDRIE0);
@@ -183,17 +230,7 @@ int8_t USART_0_init()
 	//		 | 0 << USBS0 /* USART Stop Bit Select: disabled */
 	//		 | (1 << UCSZ01) | (1 << UCSZ00); /* 8-bit */
 
-	uint8_t x;
-
-	/* Initialize ringbuffers */
-	x = 0;
-
-	USART_0_rx_tail     = x;
-	USART_0_rx_head     = x;
-	USART_0_rx_elements = x;
-	USART_0_tx_tail     = x;
-	USART_0_tx_head     = x;
-	USART_0_tx_elements = x;
+	/* The ringbuffers were set up by usart_rings_init() */
 
 	return 0;
 }
@@ -218,54 +255,61 @@ void USART_0_disable()
 	UCSR0B &= ~((1 << TXEN0) | (1 << RXEN0));
 }
 
-/* Static Variables holding the ringbuffer used in IRQ mode */
-static uint8_t          USART_1_rxbuf[USART_1_RX_BUFFER_SIZE];
-static volatile uint8_t USART_1_rx_head;
-static volatile uint8_t USART_1_rx_tail;
-static volatile uint8_t USART_1_rx_elements;
-static uint8_t          USART_1_txbuf[USART_1_TX_BUFFER_SIZE];
-static volatile uint8_t USART_1_tx_head;
-static volatile uint8_t USART_1_tx_tail;
-static volatile uint8_t USART_1_tx_elements;
+/* USART_1 rings, carved out of the pool by usart_rings_init() */
+#define USART_1_rx USART_ring[1][USART_RX]
+#define USART_1_tx USART_ring[1][USART_TX]
 
 /* Interrupt service routine for RX complete */
 ISR(USART1_RX_vect)
 {
-	uint8_t data;
-	uint8_t tmphead;
+	uint8_t  data;
+	uint16_t tmphead;
+	uint8_t  status;
 
+	/* Read the error flags first, reading UDR clears them */
+	status = UCSR1A;
 	/* Read the received data */
 	data = UDR1;
-	/* Calculate buffer index */
-	tmphead = (USART_1_rx_head + 1) & USART_1_RX_BUFFER_MASK;
-	/* Store new index */
-	USART_1_rx_head = tmphead;
+	if (status & ((1 << FE1) | (1 << DOR1) | (1 << UPE1))) {
+		USART_stats[1].rx_errors++;
+	}
+	USART_stats[1].rx_bytes++;
 
-	if (tmphead == USART_1_rx_tail) {
-		/* ERROR! Receive buffer overflow */
+	if (USART_1_rx.elements > USART_1_rx.mask) {
+		/* ERROR! Receive buffer overflow, the byte is dropped */
+		USART_stats[1].rx_overflows++;
+	} else {
+		/* Calculate buffer index */
+		tmphead = (USART_1_rx.head + 1) & USART_1_rx.mask;
+		/* Store new index */
+		USART_1_rx.head = tmphead;
+		/* Store received data in buffer */
+		USART_1_rx.buf[tmphead] = data;
+		USART_1_rx.elements++;
+		if (USART_1_rx.elements > USART_stats[1].rx_hwm) {
+			USART_stats[1].rx_hwm = USART_1_rx.elements;
+		}
 	}
-	/* Store received data in buffer */
-	USART_1_rxbuf[tmphead] = data;
-	USART_1_rx_elements++;
 }
 
 /* Interrupt service routine for Data Register Empty */
 ISR(USART1_UDRE_vect)
 {
-	uint8_t tmptail;
+	uint16_t tmptail;
 
 	/* Check if all data is transmitted */
-	if (USART_1_tx_elements != 0) {
+	if (USART_1_tx.elements != 0) {
 		/* Calculate buffer index */
-		tmptail = (USART_1_tx_tail + 1) & USART_1_TX_BUFFER_MASK;
+		tmptail = (USART_1_tx.tail + 1) & USART_1_tx.mask;
 		/* Store new index */
-		USART_1_tx_tail = tmptail;
+		USART_1_tx.tail = tmptail;
 		/* Start transmission */
-		UDR1 = USART_1_txbuf[tmptail];
-		USART_1_tx_elements--;
+		UDR1 = USART_1_tx.buf[tmptail];
+		USART_1_tx.elements--;
+		USART_stats[1].tx_bytes++;
 	}
 
-	if (USART_1_tx_elements == 0) {
+	if (USART_1_tx.elements == 0) {
 		/* Disable UDRE interrupt */
 		UCSR1B &= ~(1 << UDRIE1);
 	}
@@ -273,12 +317,12 @@ ISR(USART1_UDRE_vect)
 
 bool USART_1_is_tx_ready()
 {
-	return (USART_1_tx_elements != USART_1_TX_BUFFER_SIZE);
+	return (USART_1_tx_count() <= USART_1_tx.mask);
 }
 
 bool USART_1_is_rx_ready()
 {
-	return (USART_1_rx_elements != 0);
+	return (USART_1_rx_count() != 0);
 }
 
 bool USART_1_is_tx_busy()
@@ -286,40 +330,56 @@ bool USART_1_is_tx_busy()
 	return (!(UCSR1A & (1 << TXC1)));
 }
 
+uint16_t USART_1_rx_count()
+{
+	return usart_ring_count(&USART_1_rx);
+}
+
+uint16_t USART_1_tx_count()
+{
+	return usart_ring_count(&USART_1_tx);
+}
+
 uint8_t USART_1_read(void)
 {
-	uint8_t tmptail;
+	uint16_t tmptail;
+	uint8_t  data;
 
 	/* Wait for incoming data */
-	while (USART_1_rx_elements == 0)
+	while (!USART_1_is_rx_ready())
 		;
 	/* Calculate buffer index */
-	tmptail = (USART_1_rx_tail + 1) & USART_1_RX_BUFFER_MASK;
+	tmptail = (USART_1_rx.tail + 1) & USART_1_rx.mask;
+	/* Take the data before the slot is handed back to the ISR */
+	data = USART_1_rx.buf[tmptail];
 	/* Store new index */
-	USART_1_rx_tail = tmptail;
+	USART_1_rx.tail = tmptail;
 	ENTER_CRITICAL(R);
-	USART_1_rx_elements--;
+	USART_1_rx.elements--;
 	EXIT_CRITICAL(R);
 
 	/* Return data */
-	return USART_1_rxbuf[tmptail];
+	return data;
 }
 
 void USART_1_write(const uint8_t data)
 {
-	uint8_t tmphead;
+	uint16_t tmphead;
 
-	/* Calculate buffer index */
-	tmphead = (USART_1_tx_head + 1) & USART_1_TX_BUFFER_MASK;
 	/* Wait for free space in buffer */
-	while (USART_1_tx_elements == USART_1_TX_BUFFER_SIZE)
+	while (!USART_1_is_tx_ready())
 		;
+	/* Calculate buffer index */
+	tmphead = (USART_1_tx.head + 1) & USART_1_tx.mask;
 	/* Store data in buffer */
-	USART_1_txbuf[tmphead] = data;
+	USART_1_tx.buf[tmphead] = data;
 	/* Store new index */
-	USART_1_tx_head = tmphead;
+	USART_1_tx.head = tmphead;
 	ENTER_CRITICAL(W);
-	USART_1_tx_elements++;
+	USART_1_tx.elements++;
+	if (USART_1_tx.elements > USART_stats[1].tx_hwm) {
+		USART_stats[1].tx_hwm = USART_1_tx.elements;
+	}
 	EXIT_CRITICAL(W);
 	/* Enable UDRE interrupt */
 	UCSR1B |= (1 << UDRIE1);
@@ -354,17 +414,7 @@ int8_t USART_1_init()
 	//		 | 0 << USBS1 /* USART Stop Bit Select: disabled */
 	//		 | (1 << UCSZ11) | (1 << UCSZ10); /* 8-bit */
 
-	uint8_t x;
-
-	/* Initialize ringbuffers */
-	x = 0;
-
-	USART_1_rx_tail     = x;
-	USART_1_rx_head     = x;
-	USART_1_rx_elements = x;
-	USART_1_tx_tail     = x;
-	USART_1_tx_head     = x;
-	USART_1_tx_elements = x;
+	/* The ringbuffers were set up by usart_rings_init() */
 
 	return 0;
 }
@@ -389,67 +439,87 @@ void USART_1_disable()
 	UCSR1B &= ~((1 << TXEN1) | (1 << RXEN1));
 }
 
-/* Static Variables holding the ringbuffer used in IRQ mode */
-static uint8_t          USART_2_rxbuf[USART_2_RX_BUFFER_SIZE];
-static volatile uint8_t USART_2_rx_head;
-static volatile uint8_t USART_2_rx_tail;
-static volatile uint8_t USART_2_rx_elements;
-static uint8_t          USART_2_txbuf[USART_2_TX_BUFFER_SIZE];
-static volatile uint8_t USART_2_tx_head;
-static volatile uint8_t USART_2_tx_tail;
-static volatile uint8_t USART_2_tx_elements;
+/* USART_2 rings, carved out of the pool by usart_rings_init() */
+#define USART_2_rx USART_ring[2][USART_RX]
+#define USART_2_tx USART_ring[2][USART_TX]
 
+#if !USART_ASM_ISR	/* else see usart_relay.S */
 /* Interrupt service routine for RX complete */
 ISR(USART2_RX_vect)
 {
-	uint8_t data;
-	uint8_t tmphead;
+	uint8_t  data;
+	uint16_t tmphead;
+	uint8_t  status;
+	PROF_ENTER();
 
+	/* Read the error flags first, reading UDR clears them */
+	status = UCSR2A;
 	/* Read the received data */
 	data = UDR2;
-	/* Calculate buffer index */
-	tmphead = (USART_2_rx_head + 1) & USART_2_RX_BUFFER_MASK;
-	/* Store new index */
-	USART_2_rx_head = tmphead;
+	if (status & ((1 << FE2) | (1 << DOR2) | (1 << UPE2))) {
+		USART_stats[2].rx_errors++;
+	}
+	USART_stats[2].rx_bytes++;
 
-	if (tmphead == USART_2_rx_tail) {
-		/* ERROR! Receive buffer overflow */
+	if (USART_2_rx.elements > USART_2_rx.mask) {
+		/* ERROR! Receive buffer overflow, the byte is dropped */
+		USART_stats[2].rx_overflows++;
+	} else {
+		/* Calculate buffer index */
+		tmphead = (USART_2_rx.head + 1) & USART_2_rx.mask;
+		/* Store new index */
+		USART_2_rx.head = tmphead;
+		/* Store received data in buffer */
+		USART_2_rx.buf[tmphead] = data;
+#if LATENCY_HIST
+		USART_2_rx.stamp[tmphead] = lat_ticks();
+#endif
+		USART_2_rx.elements++;
+		if (USART_2_rx.elements > USART_stats[2].rx_hwm) {
+			USART_stats[2].rx_hwm = USART_2_rx.elements;
+		}
 	}
-	/* Store received data in buffer */
-	USART_2_rxbuf[tmphead] = data;
-	USART_2_rx_elements++;
+	PROF_EXIT(PV_U2RX);
 }
 
 /* Interrupt service routine for Data Register Empty */
 ISR(USART2_UDRE_vect)
 {
-	uint8_t tmptail;
+	uint16_t tmptail;
+	PROF_ENTER();
 
 	/* Check if all data is transmitted */
-	if (USART_2_tx_elements != 0) {
+	if (USART_2_tx.elements != 0) {
 		/* Calculate buffer index */
-		tmptail = (USART_2_tx_tail + 1) & USART_2_TX_BUFFER_MASK;
+		tmptail = (USART_2_tx.tail + 1) & USART_2_tx.mask;
 		/* Store new index */
-		USART_2_tx_tail = tmptail;
+		USART_2_tx.tail = tmptail;
 		/* Start transmission */
-		UDR2 = USART_2_txbuf[tmptail];
-		USART_2_tx_elements--;
+		UDR2 = USART_2_tx.buf[tmptail];
+#if LATENCY_HIST
+		lat_record(LAT_PC2LCD, USART_2_tx.stamp[tmptail]);
+#endif
+		USART_2_tx.elements--;
+		USART_stats[2].tx_bytes++;
 	}
 
-	if (USART_2_tx_elements == 0) {
+	if (USART_2_tx.elements == 0) {
 		/* Disable UDRE interrupt */
 		UCSR2B &= ~(1 << UDRIE2);
 	}
+	PROF_EXIT(PV_U2UDRE);
 }
 
+#endif /* !USART_ASM_ISR */
+
 bool USART_2_is_tx_ready()
 {
-	return (USART_2_tx_elements != USART_2_TX_BUFFER_SIZE);
+	return (USART_2_tx_count() <= USART_2_tx.mask);
 }
 
 bool USART_2_is_rx_ready()
 {
-	return (USART_2_rx_elements != 0);
+	return (USART_2_rx_count() != 0);
 }
 
 bool USART_2_is_tx_busy()
@@ -457,40 +527,62 @@ bool USART_2_is_tx_busy()
 	return (!(UCSR2A & (1 << TXC2)));
 }
 
+uint16_t USART_2_rx_count()
+{
+	return usart_ring_count(&USART_2_rx);
+}
+
+uint16_t USART_2_tx_count()
+{
+	return usart_ring_count(&USART_2_tx);
+}
+
 uint8_t USART_2_read(void)
 {
-	uint8_t tmptail;
+	uint16_t tmptail;
+	uint8_t  data;
 
 	/* Wait for incoming data */
-	while (USART_2_rx_elements == 0)
+	while (!USART_2_is_rx_ready())
 		;
 	/* Calculate buffer index */
-	tmptail = (USART_2_rx_tail + 1) & USART_2_RX_BUFFER_MASK;
+	tmptail = (USART_2_rx.tail + 1) & USART_2_rx.mask;
+	/* Take the data before the slot is handed back to the ISR */
+	data = USART_2_rx.buf[tmptail];
+#if LATENCY_HIST
+	lat_stamp[LAT_LCD2PC] = USART_2_rx.stamp[tmptail];
+#endif
 	/* Store new index */
-	USART_2_rx_tail = tmptail;
+	USART_2_rx.tail = tmptail;
 	ENTER_CRITICAL(R);
-	USART_2_rx_elements--;
+	USART_2_rx.elements--;
 	EXIT_CRITICAL(R);
 
 	/* Return data */
-	return USART_2_rxbuf[tmptail];
+	return data;
 }
 
 void USART_2_write(const uint8_t data)
 {
-	uint8_t tmphead;
+	uint16_t tmphead;
 
-	/* Calculate buffer index */
-	tmphead = (USART_2_tx_head + 1) & USART_2_TX_BUFFER_MASK;
 	/* Wait for free space in buffer */
-	while (USART_2_tx_elements == USART_2_TX_BUFFER_SIZE)
+	while (!USART_2_is_tx_ready())
 		;
+	/* Calculate buffer index */
+	tmphead = (USART_2_tx.head + 1) & USART_2_tx.mask;
 	/* Store data in buffer */
-	USART_2_txbuf[tmphead] = data;
+	USART_2_tx.buf[tmphead] = data;
+#if LATENCY_HIST
+	USART_2_tx.stamp[tmphead] = lat_stamp[LAT_PC2LCD];
+#endif
 	/* Store new index */
-	USART_2_tx_head = tmphead;
+	USART_2_tx.head = tmphead;
 	ENTER_CRITICAL(W);
-	USART_2_tx_elements++;
+	USART_2_tx.elements++;
+	if (USART_2_tx.elements > USART_stats[2].tx_hwm) {
+		USART_stats[2].tx_hwm = USART_2_tx.elements;
+	}
 	EXIT_CRITICAL(W);
 	/* Enable UDRE interrupt */
 	UCSR2B |= (1 << UDRIE2);
@@ -525,17 +617,7 @@ int8_t USART_2_init()
 	//		 | 0 << USBS2 /* USART Stop Bit Select: disabled */
 	//		 | (1 << UCSZ21) | (1 << UCSZ20); /* 8-bit */
 
-	uint8_t x;
-
-	/* Initialize ringbuffers */
-	x = 0;
-
-	USART_2_rx_tail     = x;
-	USART_2_rx_head     = x;
-	USART_2_rx_elements = x;
-	USART_2_tx_tail     = x;
-	USART_2_tx_head     = x;
-	USART_2_tx_elements = x;
+	/* The ringbuffers were set up by usart_rings_init() */
 
 	return 0;
 }
@@ -581,67 +663,78 @@ int putchar(int outChar)
 }
 #endif
 
-/* Static Variables holding the ringbuffer used in IRQ mode */
-static uint8_t          USART_3_rxbuf[USART_3_RX_BUFFER_SIZE];
-static volatile uint8_t USART_3_rx_head;
-static volatile uint8_t USART_3_rx_tail;
-static volatile uint8_t USART_3_rx_elements;
-static uint8_t          USART_3_txbuf[USART_3_TX_BUFFER_SIZE];
-static volatile uint8_t USART_3_tx_head;
-static volatile uint8_t USART_3_tx_tail;
-static volatile uint8_t USART_3_tx_elements;
+/* USART_3 rings, carved out of the pool by usart_rings_init() */
+#define USART_3_rx USART_ring[3][USART_RX]
+#define USART_3_tx USART_ring[3][USART_TX]
 
 /* Interrupt service routine for RX complete */
 ISR(USART3_RX_vect)
 {
-	uint8_t data;
-	uint8_t tmphead;
+	uint8_t  data;
+	uint16_t tmphead;
+	uint8_t  status;
+	PROF_ENTER();
 
+	/* Read the error flags first, reading UDR clears them */
+	status = UCSR3A;
 	/* Read the received data */
 	data = UDR3;
-	/* Calculate buffer index */
-	tmphead = (USART_3_rx_head + 1) & USART_3_RX_BUFFER_MASK;
-	/* Store new index */
-	USART_3_rx_head = tmphead;
+	if (status & ((1 << FE3) | (1 << DOR3) | (1 << UPE3))) {
+		USART_stats[3].rx_errors++;
+	}
+	USART_stats[3].rx_bytes++;
 
-	if (tmphead == USART_3_rx_tail) {
-		/* ERROR! Receive buffer overflow */
+	if (USART_3_rx.elements > USART_3_rx.mask) {
+		/* ERROR! Receive buffer overflow, the byte is dropped */
+		USART_stats[3].rx_overflows++;
+	} else {
+		/* Calculate buffer index */
+		tmphead = (USART_3_rx.head + 1) & USART_3_rx.mask;
+		/* Store new index */
+		USART_3_rx.head = tmphead;
+		/* Store received data in buffer */
+		USART_3_rx.buf[tmphead] = data;
+		USART_3_rx.elements++;
+		if (USART_3_rx.elements > USART_stats[3].rx_hwm) {
+			USART_stats[3].rx_hwm = USART_3_rx.elements;
+		}
 	}
-	/* Store received data in buffer */
-	USART_3_rxbuf[tmphead] = data;
-	USART_3_rx_elements++;
+	PROF_EXIT(PV_U3RX);
 }
 
 /* Interrupt service routine for Data Register Empty */
 ISR(USART3_UDRE_vect)
 {
-	uint8_t tmptail;
+	uint16_t tmptail;
+	PROF_ENTER();
 
 	/* Check if all data is transmitted */
-	if (USART_3_tx_elements != 0) {
+	if (USART_3_tx.elements != 0) {
 		/* Calculate buffer index */
-		tmptail = (USART_3_tx_tail + 1) & USART_3_TX_BUFFER_MASK;
+		tmptail = (USART_3_tx.tail + 1) & USART_3_tx.mask;
 		/* Store new index */
-		USART_3_tx_tail = tmptail;
+		USART_3_tx.tail = tmptail;
 		/* Start transmission */
-		UDR3 = USART_3_txbuf[tmptail];
-		USART_3_tx_elements--;
+		UDR3 = USART_3_tx.buf[tmptail];
+		USART_3_tx.elements--;
+		USART_stats[3].tx_bytes++;
 	}
 
-	if (USART_3_tx_elements == 0) {
+	if (USART_3_tx.elements == 0) {
 		/* Disable UDRE interrupt */
 		UCSR3B &= ~(1 << UDRIE3);
 	}
+	PROF_EXIT(PV_U3UDRE);
 }
 
 bool USART_3_is_tx_ready()
 {
-	return (USART_3_tx_elements != USART_3_TX_BUFFER_SIZE);
+	return (USART_3_tx_count() <= USART_3_tx.mask);
 }
 
 bool USART_3_is_rx_ready()
 {
-	return (USART_3_rx_elements != 0);
+	return (USART_3_rx_count() != 0);
 }
 
 bool USART_3_is_tx_busy()
@@ -649,40 +742,56 @@ bool USART_3_is_tx_busy()
 	return (!(UCSR3A & (1 << TXC3)));
 }
 
+uint16_t USART_3_rx_count()
+{
+	return usart_ring_count(&USART_3_rx);
+}
+
+uint16_t USART_3_tx_count()
+{
+	return usart_ring_count(&USART_3_tx);
+}
+
 uint8_t USART_3_read(void)
 {
-	uint8_t tmptail;
+	uint16_t tmptail;
+	uint8_t  data;
 
 	/* Wait for incoming data */
-	while (USART_3_rx_elements == 0)
+	while (!USART_3_is_rx_ready())
 		;
 	/* Calculate buffer index */
-	tmptail = (USART_3_rx_tail + 1) & USART_3_RX_BUFFER_MASK;
+	tmptail = (USART_3_rx.tail + 1) & USART_3_rx.mask;
+	/* Take the data before the slot is handed back to the ISR */
+	data = USART_3_rx.buf[tmptail];
 	/* Store new index */
-	USART_3_rx_tail = tmptail;
+	USART_3_rx.tail = tmptail;
 	ENTER_CRITICAL(R);
-	USART_3_rx_elements--;
+	USART_3_rx.elements--;
 	EXIT_CRITICAL(R);
 
 	/* Return data */
-	return USART_3_rxbuf[tmptail];
+	return data;
 }
 
 void USART_3_write(const uint8_t data)
 {
-	uint8_t tmphead;
+	uint16_t tmphead;
 
-	/* Calculate buffer index */
-	tmphead = (USART_3_tx_head + 1) & USART_3_TX_BUFFER_MASK;
 	/* Wait for free space in buffer */
-	while (USART_3_tx_elements == USART_3_TX_BUFFER_SIZE)
+	while (!USART_3_is_tx_ready())
 		;
+	/* Calculate buffer index */
+	tmphead = (USART_3_tx.head + 1) & USART_3_tx.mask;
 	/* Store data in buffer */
-	USART_3_txbuf[tmphead] = data;
+	USART_3_tx.buf[tmphead] = data;
 	/* Store new index */
-	USART_3_tx_head = tmphead;
+	USART_3_tx.head = tmphead;
 	ENTER_CRITICAL(W);
-	USART_3_tx_elements++;
+	USART_3_tx.elements++;
+	if (USART_3_tx.elements > USART_stats[3].tx_hwm) {
+		USART_stats[3].tx_hwm = USART_3_tx.elements;
+	}
 	EXIT_CRITICAL(W);
 	/* Enable UDRE interrupt */
 	UCSR3B |= (1 << UDRIE3);
@@ -717,17 +826,7 @@ int8_t USART_3_init()
 	//		 | 0 << USBS3 /* USART Stop Bit Select: disabled */
 	//		 | (1 << UCSZ31) | (1 << UCSZ30); /* 8-bit */
 
-	uint8_t x;
-
-	/* Initialize ringbuffers */
-	x = 0;
-
-	USART_3_rx_tail     = x;
-	USART_3_rx_head     = x;
-	USART_3_rx_elements = x;
-	USART_3_tx_tail     = x;
-	USART_3_tx_head     = x;
-	USART_3_tx_elements = x;
+	/* The ringbuffers were set up by usart_rings_init() */
 
 #if defined(__GNUC__)
 	stdout = &USART_3_stream;
@@ -0,0 +1,203 @@
+/**
+ * \file
+ *
+ * \brief Pool backed USART ring buffers
+ *
+ * All eight rings share one SRAM pool so the bridge can hand most of it
+ * to whichever direction is busy in the current phase. A layout is a
+ * table of power of 2 sizes; if it does not fit the pool (the latency
+ * stamps take two more bytes a slot) every ring is halved until it does.
+ */
+#include <compiler.h>
+#include <avr/pgmspace.h>
+#include <stddef.h>
+#include <string.h>
+#include <usart_basic.h>
+#include <atomic.h>
+#include <bridge_config.h>
+#include <usart_offsets.h>
+
+#define RING_MIN 2
+
+/* usart_relay.S relies on these (2 byte pointers, so only on the target) */
+#ifdef __AVR__
+_Static_assert(offsetof(struct usart_ring, buf) == RING_OFF_BUF, "ring layout");
+_Static_assert(offsetof(struct usart_ring, stamp) == RING_OFF_STAMP, "ring layout");
+_Static_assert(offsetof(struct usart_ring, mask) == RING_OFF_MASK, "ring layout");
+_Static_assert(offsetof(struct usart_ring, head) == RING_OFF_HEAD, "ring layout");
+_Static_assert(offsetof(struct usart_ring, tail) == RING_OFF_TAIL, "ring layout");
+_Static_assert(offsetof(struct usart_ring, elements) == RING_OFF_ELEMENTS, "ring layout");
+_Static_assert(sizeof(struct usart_ring) == RING_SIZEOF, "ring layout");
+_Static_assert(offsetof(struct usart_stats, rx_bytes) == STATS_OFF_RXBYTES, "stats layout");
+_Static_assert(offsetof(struct usart_stats, tx_bytes) == STATS_OFF_TXBYTES, "stats layout");
+_Static_assert(offsetof(struct usart_stats, rx_overflows) == STATS_OFF_RXOVF, "stats layout");
+_Static_assert(offsetof(struct usart_stats, rx_errors) == STATS_OFF_RXERR, "stats layout");
+_Static_assert(offsetof(struct usart_stats, rx_hwm) == STATS_OFF_RXHWM, "stats layout");
+_Static_assert(offsetof(struct usart_stats, tx_hwm) == STATS_OFF_TXHWM, "stats layout");
+_Static_assert(sizeof(struct usart_stats) == STATS_SIZEOF, "stats layout");
+#endif
+
+struct usart_ring USART_ring[4][2];
+
+static uint8_t ring_pool[USART_RING_POOL];
+
+static const uint16_t boot_sizes[4][2] PROGMEM = {
+	{USART_0_RX_BUFFER_SIZE, USART_0_TX_BUFFER_SIZE},
+	{USART_1_RX_BUFFER_SIZE, USART_1_TX_BUFFER_SIZE},
+	{USART_2_RX_BUFFER_SIZE, USART_2_TX_BUFFER_SIZE},
+	{USART_3_RX_BUFFER_SIZE, USART_3_TX_BUFFER_SIZE},
+};
+
+/* bytes a slot takes: the data, plus a timestamp on the bridged ports */
+static uint8_t slot_bytes(uint8_t usart)
+{
+#if LATENCY_HIST
+	if ((usart == 0) || (usart == 2)) {
+		return 3;
+	}
+#else
+	UNUSED(usart);
+#endif
+	return 1;
+}
+
+/* Pool order: the debug and spare ports first, so as long as every plan
+ * gives them the same sizes they stay put and are never drained */
+static const uint8_t pool_order[4] = {3, 1, 0, 2};
+
+struct ring_place {
+	uint8_t *buf;
+	uint16_t mask;
+};
+
+/* where every ring goes for these sizes */
+static void rings_place(const uint16_t *sizes_P, struct ring_place place[4][2])
+{
+	uint16_t size[4][2];
+	uint16_t used;
+	uint8_t *p;
+	uint8_t  u, d, i, shift;
+
+	for (shift = 0;; shift++) {
+		used = 0;
+		for (u = 0; u < 4; u++) {
+			for (d = 0; d < 2; d++) {
+				size[u][d] = pgm_read_word(&sizes_P[u * 2 + d]) >> shift;
+				if (size[u][d] < RING_MIN) {
+					size[u][d] = RING_MIN;
+				}
+				used += size[u][d] * slot_bytes(u);
+			}
+		}
+		if (used <= sizeof ring_pool) {
+			break;
+		}
+	}
+
+	p = ring_pool;
+	for (i = 0; i < 4; i++) {
+		u = pool_order[i];
+		for (d = 0; d < 2; d++) {
+			place[u][d].buf  = p;
+			place[u][d].mask = size[u][d] - 1;
+			p += size[u][d] * slot_bytes(u);
+		}
+	}
+}
+
+static bool ring_moves(uint8_t u, uint8_t d, struct ring_place place[4][2])
+{
+	return (USART_ring[u][d].buf != place[u][d].buf) || (USART_ring[u][d].mask != place[u][d].mask);
+}
+
+/* point a ring at its new place, empty */
+static void ring_set(struct usart_ring *r, uint8_t u, struct ring_place *pl)
+{
+	r->buf   = pl->buf;
+	r->stamp = (slot_bytes(u) > 1) ? (uint16_t *)(pl->buf + pl->mask + 1) : NULL;
+	r->mask  = pl->mask;
+	r->head     = 0;
+	r->tail     = 0;
+	r->elements = 0;
+}
+
+void usart_rings_init(void)
+{
+	struct ring_place place[4][2];
+	uint8_t           u, d;
+
+	rings_place(&boot_sizes[0][0], place);
+	for (u = 0; u < 4; u++) {
+		for (d = 0; d < 2; d++) {
+			ring_set(&USART_ring[u][d], u, &place[u][d]);
+		}
+	}
+}
+
+uint16_t usart_ring_size(uint8_t usart, uint8_t dir)
+{
+	return USART_ring[usart][dir].mask + 1;
+}
+
+bool usart_rings_resize(const uint16_t *sizes_P)
+{
+	struct ring_place  place[4][2];
+	uint8_t            stash[4][USART_RING_STASH];
+	uint8_t            n[4];
+	uint8_t            u, i;
+	struct usart_ring *r;
+
+	rings_place(sizes_P, place);
+
+	/* Transmitters empty their rings at line rate and nothing refills
+	 * them while we are in here */
+	for (u = 0; u < 4; u++) {
+		if (ring_moves(u, USART_TX, place)) {
+			while (usart_ring_count(&USART_ring[u][USART_TX]) != 0)
+				;
+		}
+	}
+
+	ENTER_CRITICAL(W);
+	for (u = 0; u < 4; u++) {
+		if (ring_moves(u, USART_RX, place) && (USART_ring[u][USART_RX].elements > USART_RING_STASH)) {
+			EXIT_CRITICAL(W);
+			return false;
+		}
+	}
+	for (u = 0; u < 4; u++) {
+		n[u] = 0;
+		if (ring_moves(u, USART_TX, place)) {
+			ring_set(&USART_ring[u][USART_TX], u, &place[u][USART_TX]);
+		}
+		if (!ring_moves(u, USART_RX, place)) {
+			continue;
+		}
+		/* Take out whatever has arrived and not been read yet */
+		r    = &USART_ring[u][USART_RX];
+		n[u] = r->elements;
+		for (i = 0; i < n[u]; i++) {
+			r->tail     = (r->tail + 1) & r->mask;
+			stash[u][i] = r->buf[r->tail];
+		}
+	}
+	/* Only now, as a moved ring may overlap where another one was */
+	for (u = 0; u < 4; u++) {
+		if (!ring_moves(u, USART_RX, place)) {
+			continue;
+		}
+		r = &USART_ring[u][USART_RX];
+		ring_set(r, u, &place[u][USART_RX]);
+		/* and put it back at the front of the new ring */
+		for (i = 0; i < n[u]; i++) {
+			r->head         = (r->head + 1) & r->mask;
+			r->buf[r->head] = stash[u][i];
+			if (r->stamp) {
+				r->stamp[r->head] = 0;
+			}
+		}
+		r->elements = n[u];
+	}
+	EXIT_CRITICAL(W);
+	return true;
+}
@@ -0,0 +1,174 @@
+// SD card TFT store glue, see store.h
+// The FAT window and the data sectors live in the upload arena, which is
+// only ours during PH_UPLOAD, so the window is let go after every use.
+// A capture never waits on the card where the upload is forwarded: bytes
+// fill one sector while the last full one waits to be written by
+// store_service(), which only starts once the card has finished the write
+// before. If the card falls a whole sector behind, the capture is dropped.
+
+#include <atmel_start.h>
+#include <bridge_config.h>
+#include "arena.h"
+#include "dlog.h"
+#include "sd_spi.h"
+#include "store.h"
+
+#if TFT_STORE
+
+#define STORE_BUSY_MS	2		// a sector's write waits no longer on the card's own FAT and CRC writes
+
+struct tftstore tft_store;
+
+static uint8_t *fill;			// capture bytes go in here
+static uint16_t filled;
+static uint8_t *queued;			// a full sector for store_service(), NULL for none
+
+void store_init(void)
+{
+	uint8_t i, n;
+
+	if (!sd_init() || !tftstore_mount(&tft_store, &sd_dev, arena.win, arena.buf))
+	{
+		dlog0(DL_STORE_NONE);
+		return;
+	}
+	fat_release(&tft_store.vol);
+	n = 0;
+	for (i = 0; i < TFT_SLOTS; i++)
+	{
+		n += tft_store.cat[i].used;
+	}
+	dlog1(DL_STORE_UP, n);
+}
+
+void store_capture_begin(const char *sig, uint32_t size, int8_t keep)
+{
+	char model[TFT_MODEL_LEN];
+
+	if (!tft_store.mounted || (size == 0))
+	{
+		return;
+	}
+	tft_model(sig, model);
+	if (tftstore_begin(&tft_store, model, size, arena.buf, arena.sums, keep))
+	{
+		fill = arena.cap;
+		filled = 0;
+		queued = NULL;
+		dlog1(DL_STORE_CAPTURE, tft_store.slot);
+	}
+	else
+	{
+		fat_release(&tft_store.vol);
+		dlog1(DL_STORE_DROPPED, 0);
+	}
+}
+
+static void store_drop(void)
+{
+	tftstore_abort(&tft_store);
+	fat_release(&tft_store.vol);
+	dlog1(DL_STORE_DROPPED, tft_store.file.pos);
+}
+
+// n bytes at p on to the file, written from where they are: the file's
+// sector buffer is pointed at them, so fat_write() copies them onto
+// themselves
+static bool store_write(uint8_t *p, uint16_t n, uint16_t ms)
+{
+	bool ok;
+
+	tft_store.file.buf = p;
+	sd_wait_limit(ms);
+	ok = tftstore_put(&tft_store, p, n);
+	sd_wait_limit(SD_BUSY_MS);
+	return(ok);
+}
+
+void store_capture_put(uint8_t ch)
+{
+	if (tft_store.slot < 0)
+	{
+		return;
+	}
+	fill[filled++] = ch;
+	if (filled < BLOCK_SIZE)
+	{
+		return;
+	}
+	if (queued != NULL)		// the card hasn't kept up
+	{
+		store_drop();
+		return;
+	}
+	queued = fill;
+	fill = (fill == arena.buf) ? arena.cap : arena.buf;
+	filled = 0;
+}
+
+void store_service(void)
+{
+	if ((tft_store.slot < 0) || (queued == NULL) || !sd_idle())
+	{
+		return;
+	}
+	if (!store_write(queued, BLOCK_SIZE, STORE_BUSY_MS))
+	{
+		store_drop();
+	}
+	queued = NULL;
+}
+
+void store_capture_end(void)
+{
+	int8_t slot;
+
+	if (tft_store.slot < 0)
+	{
+		return;
+	}
+	if (((queued != NULL) && !store_write(queued, BLOCK_SIZE, SD_BUSY_MS)) || !store_write(fill, filled, SD_BUSY_MS))
+	{
+		store_drop();		// the upload is over, so the card can take its time
+		return;
+	}
+	queued = NULL;
+	slot = tftstore_end(&tft_store);
+	fat_release(&tft_store.vol);
+	if (slot >= 0)
+	{
+		dlog3(DL_STORE_SAVED, slot, tft_store.cat[slot].size, tft_store.cat[slot].crc);
+	}
+	else
+	{
+		dlog1(DL_STORE_DROPPED, tft_store.file.pos);
+	}
+}
+
+#else
+
+void store_init(void)
+{
+}
+
+void store_capture_begin(const char *sig, uint32_t size, int8_t keep)
+{
+	UNUSED(sig);
+	UNUSED(size);
+	UNUSED(keep);
+}
+
+void store_capture_put(uint8_t ch)
+{
+	UNUSED(ch);
+}
+
+void store_service(void)
+{
+}
+
+void store_capture_end(void)
+{
+}
+
+#endif
@@ -0,0 +1,31 @@
+// TFT images kept on an SD card (TFT_STORE), see tftstore.h
+//
+// Bridge 0 copies every upload it forwards to the card as it goes, and
+// catalogues it once the whole file has been written.
+
+#ifndef STORE_H_INCLUDED
+#define STORE_H_INCLUDED
+
+#include <compiler.h>
+#include <bridge_config.h>
+#include "tftstore.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if TFT_STORE
+extern struct tftstore tft_store;
+#endif
+
+void store_init(void);				// find the card, once at reset with the clock running
+void store_capture_begin(const char *sig, uint32_t size, int8_t keep);	// sig is the LCD's comok reply, keep a slot being read
+void store_capture_put(uint8_t ch);		// never waits on the card
+void store_service(void);			// writes what store_capture_put() has queued, from idle_tasks()
+void store_capture_end(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STORE_H_INCLUDED */
@@ -0,0 +1,205 @@
+// Framed binary telemetry on the debug port (USART3 unless moved)
+// A status frame is built in one go from a snapshot of the counters, then
+// COBS encoded on the fly as USART3 has room, so it never waits on the port.
+
+#include <atmel_start.h>
+#include <util/crc16.h>
+#include <atomic.h>
+#include <bridge_config.h>
+#include "bridge.h"
+#include "dlog.h"
+#include "progress.h"
+#include "telemetry.h"
+#include "telemetry_frame.h"
+#include "ports.h"
+
+#if TELEMETRY_ENABLE
+
+#if TLM_MAX_PAYLOAD > 253
+#error telemetry status frame too big for single block COBS
+#endif
+
+static bool tlm_on = TELEMETRY_DEFAULT_ON;
+static uint32_t tlm_last;			// msectime() of the last frame
+
+static uint8_t tlm_buf[TLM_MAX_PAYLOAD];	// payload + crc
+static uint8_t tlm_len;				// 0 when no frame is pending
+static uint8_t tlm_pos;				// next payload byte to encode
+static uint8_t tlm_blk;				// data bytes left in this COBS block
+static uint8_t tlm_stage;			// see telemetry_service()
+
+enum { TS_LEAD, TS_CODE, TS_DATA, TS_TAIL };
+
+static void put16(uint8_t *p, uint16_t v)
+{
+	p[0] = v & 0xff;
+	p[1] = v >> 8;
+}
+
+static void put32(uint8_t *p, uint32_t v)
+{
+	p[0] = v & 0xff;
+	p[1] = (v >> 8) & 0xff;
+	p[2] = (v >> 16) & 0xff;
+	p[3] = v >> 24;
+}
+
+// take a snapshot of everything into tlm_buf and append the crc
+static void tlm_build(void)
+{
+	const struct bridge_status *bs = &bridges[0].st;		// the frame has room for one bridge
+	struct usart_stats st;
+	uint8_t *p;
+	uint8_t i;
+	uint16_t crc;
+
+	tlm_buf[TLM_OFF_TYPE] = TLM_TYPE_STATUS;
+	tlm_buf[TLM_OFF_VERSION] = TLM_VERSION;
+	put32(&tlm_buf[TLM_OFF_UPTIME], (uint32_t)msectime());
+	tlm_buf[TLM_OFF_PHASE] = bs->phase;
+
+	for (i = 0; i < TLM_NPORTS; i++)
+	{
+		p = &tlm_buf[TLM_OFF_PORTS + i * TLM_PORT_SIZE];
+		ENTER_CRITICAL(R);
+		st = *(struct usart_stats *)&USART_stats[i];
+		EXIT_CRITICAL(R);
+		put32(p + TLM_PORT_RXBYTES, st.rx_bytes);
+		put32(p + TLM_PORT_TXBYTES, st.tx_bytes);
+		put16(p + TLM_PORT_RXOVF, st.rx_overflows);
+		put16(p + TLM_PORT_RXERR, st.rx_errors);
+		put16(p + TLM_PORT_RXUSED, usart_ring_count(&USART_ring[i][USART_RX]));
+		put16(p + TLM_PORT_TXUSED, usart_ring_count(&USART_ring[i][USART_TX]));
+		put16(p + TLM_PORT_RXHWM, st.rx_hwm);
+		put16(p + TLM_PORT_TXHWM, st.tx_hwm);
+		put16(p + TLM_PORT_RXSIZE, usart_ring_size(i, USART_RX));
+		put16(p + TLM_PORT_TXSIZE, usart_ring_size(i, USART_TX));
+	}
+
+	for (i = 0; i < TLM_NPHASES; i++)
+	{
+		put32(&tlm_buf[TLM_OFF_PHASEMS + i * 4], bs->phase_ms[i]);
+	}
+	put32(&tlm_buf[TLM_OFF_UPTOTAL], bs->up_total);
+	put32(&tlm_buf[TLM_OFF_UPSENT], bs->up_sent);
+	put16(&tlm_buf[TLM_OFF_UPACKS], bs->up_acks);
+	put16(&tlm_buf[TLM_OFF_LOGDROP], dlog_dropped());
+	put32(&tlm_buf[TLM_OFF_UPRATE], (bs->phase == PH_UPLOAD) ? progress_rate(bs) : 0);
+	put32(&tlm_buf[TLM_OFF_UPBAUD], bs->up_baud);
+	put16(&tlm_buf[TLM_OFF_ACKMIN], bs->ack_n ? bs->ack_min : 0);
+	put16(&tlm_buf[TLM_OFF_ACKAVG], bs->ack_n ? bs->ack_sum / bs->ack_n : 0);
+	put16(&tlm_buf[TLM_OFF_ACKMAX], bs->ack_max);
+
+	crc = 0xffff;
+	for (i = 0; i < TLM_STATUS_LEN; i++)
+	{
+		crc = _crc_xmodem_update(crc, tlm_buf[i]);
+	}
+	tlm_buf[TLM_STATUS_LEN] = crc >> 8;
+	tlm_buf[TLM_STATUS_LEN + 1] = crc & 0xff;
+
+	tlm_len = TLM_STATUS_LEN + TLM_CRC_LEN;
+	tlm_pos = 0;
+	tlm_stage = TS_LEAD;
+}
+
+void telemetry_enable(bool on)
+{
+	tlm_on = on;
+}
+
+bool telemetry_enabled(void)
+{
+	return(tlm_on);
+}
+
+bool telemetry_sending(void)
+{
+	return(tlm_len != 0);
+}
+
+// start a frame when one is due and send as much as the debug port will take now
+void telemetry_service(void)
+{
+	uint8_t i;
+	uint32_t now;
+
+	if (debug_port == PORT_NONE)		// every USART is bridged
+	{
+		return;
+	}
+	if (tlm_len == 0)
+	{
+		now = (uint32_t)msectime();
+		if (!tlm_on || (now - tlm_last < TELEMETRY_PERIOD_MS))
+		{
+			return;
+		}
+		tlm_last = now;
+		tlm_build();
+	}
+
+	while (ports[debug_port].tx_ready())
+	{
+		switch (tlm_stage)
+		{
+		case TS_LEAD:		// leading delimiter, so any text before us is cut off
+			ports[debug_port].write(0x00);
+			tlm_stage = TS_CODE;
+			break;
+
+		case TS_CODE:		// length of the run up to the next zero (or the end)
+			for (i = tlm_pos; (i < tlm_len) && tlm_buf[i]; i++)
+			;
+			tlm_blk = i - tlm_pos;
+			ports[debug_port].write(tlm_blk + 1);
+			tlm_stage = TS_DATA;
+			break;
+
+		case TS_DATA:
+			if (tlm_blk)
+			{
+				ports[debug_port].write(tlm_buf[tlm_pos++]);
+				tlm_blk--;
+			}
+			else if (tlm_pos < tlm_len)		// stopped on a zero, skip it and start the next block
+			{
+				tlm_pos++;
+				tlm_stage = TS_CODE;
+			}
+			else
+			{
+				tlm_stage = TS_TAIL;
+			}
+			break;
+
+		default:			// trailing delimiter, frame done
+			ports[debug_port].write(0x00);
+			tlm_len = 0;
+			return;
+		}
+	}
+}
+
+#else
+
+void telemetry_enable(bool on)
+{
+	UNUSED(on);
+}
+
+bool telemetry_enabled(void)
+{
+	return(false);
+}
+
+bool telemetry_sending(void)
+{
+	return(false);
+}
+
+void telemetry_service(void)
+{
+}
+
+#endif
@@ -0,0 +1,21 @@
+// Framed binary telemetry on USART3, see telemetry_frame.h for the layout
+
+#ifndef TELEMETRY_H_INCLUDED
+#define TELEMETRY_H_INCLUDED
+
+#include <compiler.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void telemetry_enable(bool on);		// start or stop the periodic frames
+bool telemetry_enabled(void);
+void telemetry_service(void);		// idle-time: build and trickle out frames
+bool telemetry_sending(void);		// a frame is part way out of the door
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TELEMETRY_H_INCLUDED */
@@ -0,0 +1,52 @@
+// Binary telemetry frame layout, shared by the firmware and the host decoder
+//
+// On the wire each frame is 0x00, COBS(payload + crc16), 0x00.
+// The crc is CRC-16/CCITT (poly 0x1021, init 0xffff, not reflected) over
+// the payload, sent high byte first. All payload fields are little endian.
+// Anything between delimiters that does not decode is plain debug text.
+
+#ifndef TELEMETRY_FRAME_H_INCLUDED
+#define TELEMETRY_FRAME_H_INCLUDED
+
+#define TLM_TYPE_STATUS		0x01
+#define TLM_VERSION			3
+
+#define TLM_NPORTS			4
+#define TLM_NPHASES			4
+
+// status frame field offsets
+#define TLM_OFF_TYPE		0	// u8
+#define TLM_OFF_VERSION		1	// u8
+#define TLM_OFF_UPTIME		2	// u32 ms since reset
+#define TLM_OFF_PHASE		6	// u8 enum bridge_phase
+#define TLM_OFF_PORTS		7	// TLM_NPORTS port blocks
+
+// port block, one per USART 0..3
+#define TLM_PORT_RXBYTES	0	// u32
+#define TLM_PORT_TXBYTES	4	// u32
+#define TLM_PORT_RXOVF		8	// u16 bytes dropped on a full ring
+#define TLM_PORT_RXERR		10	// u16 frame/overrun/parity errors
+#define TLM_PORT_RXUSED		12	// u16 rx ring occupancy now
+#define TLM_PORT_TXUSED		14	// u16 tx ring occupancy now
+#define TLM_PORT_RXHWM		16	// u16 rx ring high-water mark
+#define TLM_PORT_TXHWM		18	// u16 tx ring high-water mark
+#define TLM_PORT_RXSIZE		20	// u16 rx ring size now
+#define TLM_PORT_TXSIZE		22	// u16 tx ring size now
+#define TLM_PORT_SIZE		24
+
+#define TLM_OFF_PHASEMS		(TLM_OFF_PORTS + TLM_NPORTS * TLM_PORT_SIZE)	// u32 per phase
+#define TLM_OFF_UPTOTAL		(TLM_OFF_PHASEMS + TLM_NPHASES * 4)	// u32 file size, 0 if unknown
+#define TLM_OFF_UPSENT		(TLM_OFF_UPTOTAL + 4)	// u32 bytes forwarded to the LCD
+#define TLM_OFF_UPACKS		(TLM_OFF_UPSENT + 4)	// u16 LCD chunk acks
+#define TLM_OFF_LOGDROP		(TLM_OFF_UPACKS + 2)	// u16 debug log records dropped
+#define TLM_OFF_UPRATE		(TLM_OFF_LOGDROP + 2)	// u32 effective upload bytes/sec
+#define TLM_OFF_UPBAUD		(TLM_OFF_UPRATE + 4)	// u32 upload line baud
+#define TLM_OFF_ACKMIN		(TLM_OFF_UPBAUD + 4)	// u16 chunk ack latency ms
+#define TLM_OFF_ACKAVG		(TLM_OFF_ACKMIN + 2)	// u16
+#define TLM_OFF_ACKMAX		(TLM_OFF_ACKAVG + 2)	// u16
+#define TLM_STATUS_LEN		(TLM_OFF_ACKMAX + 2)
+
+#define TLM_CRC_LEN			2
+#define TLM_MAX_PAYLOAD		(TLM_STATUS_LEN + TLM_CRC_LEN)	// must stay under 254 for single block COBS
+
+#endif /* TELEMETRY_FRAME_H_INCLUDED */
@@ -0,0 +1,118 @@
+// TFT file checks against the display, see tftcheck.h
+
+#include <string.h>
+#include "tftcheck.h"
+
+#define F_FIRMWARE	3			// comok fields, counted from 0
+#define F_SERIAL	5
+#define F_FLASH		6
+
+// start of a comok field, NULL if the reply is shorter
+static const char *field(const char *sig, uint8_t n)
+{
+	for (; n && *sig && ((uint8_t)*sig != 0xff); sig++)
+	{
+		if (*sig == ',')
+		{
+			n--;
+		}
+	}
+	return((n || !*sig || ((uint8_t)*sig == 0xff)) ? NULL : sig);
+}
+
+static uint32_t number(const char *p)
+{
+	uint32_t v = 0;
+
+	while (p && (*p >= '0') && (*p <= '9'))
+	{
+		v = v * 10 + *p++ - '0';
+	}
+	return(v);
+}
+
+void lcd_info(const char *sig, struct lcd_info *info)
+{
+	const char *p;
+	uint8_t n;
+
+	memset(info, 0, sizeof *info);
+	tft_model(sig, info->model);
+	info->firmware = number(field(sig, F_FIRMWARE));
+	info->flash = number(field(sig, F_FLASH));
+	p = field(sig, F_SERIAL);
+	for (n = 0; p && (n < LCD_SERIAL_LEN - 1) && *p && (*p != ',') && ((uint8_t)*p != 0xff); n++)
+	{
+		info->serial[n] = *p++;
+	}
+}
+
+static bool digits(const uint8_t *p, uint8_t n)
+{
+	for (; n; n--, p++)
+	{
+		if ((*p < '0') || (*p > '9'))
+		{
+			return(false);
+		}
+	}
+	return(true);
+}
+
+// length of the model name at p, 0 if there isn't one: NX or TJC, 4
+// digits of resolution, a series letter and 3 digits of size
+static uint8_t model_at(const uint8_t *p, uint16_t n)
+{
+	uint8_t m;
+
+	if ((n >= 2) && (memcmp(p, "NX", 2) == 0))
+	{
+		m = 2;
+	}
+	else if ((n >= 3) && (memcmp(p, "TJC", 3) == 0))
+	{
+		m = 3;
+	}
+	else
+	{
+		return(0);
+	}
+	if ((n < m + 8U) || !digits(p + m, 4) || (p[m + 4] < 'A') || (p[m + 4] > 'Z') || !digits(p + m + 5, 3))
+	{
+		return(0);
+	}
+	return(m + 8);
+}
+
+uint8_t tft_check(const struct lcd_info *info, uint32_t size, const uint8_t *head, uint16_t n)
+{
+	uint8_t mine, len;
+	uint16_t i;
+	bool other;
+
+	if (info->flash && (size > info->flash))
+	{
+		return(TC_SIZE);
+	}
+	mine = model_at((const uint8_t *)info->model, strlen(info->model));
+	if (mine == 0)		// nothing to compare with
+	{
+		return(TC_OK);
+	}
+	other = false;
+	for (i = 0; i < n; i++)
+	{
+		len = model_at(head + i, n - i);
+		if (len == 0)
+		{
+			continue;
+		}
+		if ((len == mine) && (memcmp(head + i, info->model, len) == 0))
+		{
+			return(TC_OK);
+		}
+		other = true;
+		i += len - 1;
+	}
+	return(other ? TC_MODEL : TC_OK);
+}
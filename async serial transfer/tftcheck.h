@@ -0,0 +1,48 @@
+// Is a TFT file for this display? Checked before the display gets any of it
+//
+// The display describes itself in its comok reply:
+//
+//     comok 1,30601-0,NX4832T035_011R,52,61488,D264B8204F0E1828,16777216
+//
+// touch, reserved, model, firmware, MCU code, serial number and flash size.
+// A file bigger than that flash can't go on, and one whose header names
+// another model (NX4832T035, TJC4832K035: maker, resolution, series, size)
+// was built for a different panel. A header that names no model at all
+// passes, there is nothing to go by.
+// Builds on a PC as well.
+
+#ifndef TFTCHECK_H_INCLUDED
+#define TFTCHECK_H_INCLUDED
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "tftstore.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LCD_SERIAL_LEN	17		// 16 hex digits and a 0
+
+struct lcd_info {
+	char model[TFT_MODEL_LEN];		// "" if the reply had none
+	uint16_t firmware;
+	char serial[LCD_SERIAL_LEN];
+	uint32_t flash;					// bytes, 0 if not given
+};
+
+// tft_check() results
+#define TC_OK		0
+#define TC_SIZE		1			// bigger than the display's flash
+#define TC_MODEL	2			// the header names another model
+
+void lcd_info(const char *sig, struct lcd_info *info);	// comok reply -> its fields
+
+// head is the first n bytes of the file, n 0 to check only the size
+uint8_t tft_check(const struct lcd_info *info, uint32_t size, const uint8_t *head, uint16_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TFTCHECK_H_INCLUDED */
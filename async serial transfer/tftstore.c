@@ -0,0 +1,259 @@
+// TFT image catalogue, see tftstore.h
+
+#include <string.h>
+#include "crc32.h"
+#include "tftstore.h"
+
+static const char cat_name[11] = {'T', 'F', 'T', 'C', 'A', 'T', ' ', ' ', 'B', 'I', 'N'};
+
+static void slot_name(int8_t slot, bool sums, char *name)
+{
+	memcpy(name, sums ? "TFT0    CRC" : "TFT0    BIN", 11);
+	name[3] = '0' + slot;
+}
+
+void tft_model(const char *sig, char *model)
+{
+	uint8_t commas, n;
+
+	memset(model, 0, TFT_MODEL_LEN);
+	for (commas = 0; *sig && (commas < 2); sig++)		// "comok touch,reserved-x,model,..."
+	{
+		if (*sig == ',')
+		{
+			commas++;
+		}
+	}
+	for (n = 0; (n < TFT_MODEL_LEN - 1) && *sig && (*sig != ',') && ((uint8_t)*sig != 0xff); n++)
+	{
+		model[n] = *sig++;
+	}
+}
+
+static bool cat_save(struct tftstore *s, uint8_t *buf)
+{
+	struct fat_file f;
+
+	return(fat_create(&s->vol, &f, cat_name, buf) &&
+			fat_write(&f, (const uint8_t *)s->cat, sizeof s->cat) && fat_close(&f));
+}
+
+bool tftstore_mount(struct tftstore *s, const struct blockdev *dev, uint8_t *win, uint8_t *buf)
+{
+	struct fat_file f;
+	uint16_t n;
+
+	memset(s, 0, sizeof *s);
+	s->slot = -1;
+	if (!fat_mount(&s->vol, dev, win))
+	{
+		return(false);
+	}
+	if (fat_open(&s->vol, &f, cat_name, buf))		// none yet is an empty store
+	{
+		n = fat_read_sector(&f);
+		memcpy(s->cat, buf, (n < sizeof s->cat) ? n : sizeof s->cat);
+	}
+	s->mounted = true;
+	return(true);
+}
+
+int8_t tftstore_find(const struct tftstore *s, const char *model)
+{
+	int8_t i, best;
+
+	best = -1;
+	for (i = 0; i < TFT_SLOTS; i++)
+	{
+		if (s->cat[i].used && (strncmp(s->cat[i].model, model, TFT_MODEL_LEN) == 0) &&
+				((best < 0) || (s->cat[i].seq > s->cat[best].seq)))
+		{
+			best = i;
+		}
+	}
+	return(best);
+}
+
+int8_t tftstore_match(const struct tftstore *s, const char *model, uint32_t size, uint32_t crc)
+{
+	int8_t i;
+
+	for (i = 0; i < TFT_SLOTS; i++)
+	{
+		if (s->cat[i].used && (s->cat[i].size == size) && (s->cat[i].crc == crc) &&
+				(strncmp(s->cat[i].model, model, TFT_MODEL_LEN) == 0))
+		{
+			return(i);
+		}
+	}
+	return(-1);
+}
+
+// the slot a new image for model goes in: over one for the same model,
+// else an empty one, else the oldest; never over keep
+static int8_t pick_slot(const struct tftstore *s, const char *model, int8_t keep)
+{
+	int8_t i, slot;
+
+	for (i = 0; i < TFT_SLOTS; i++)
+	{
+		if ((i != keep) && s->cat[i].used && (strncmp(s->cat[i].model, model, TFT_MODEL_LEN) == 0))
+		{
+			return(i);
+		}
+	}
+	for (i = 0; i < TFT_SLOTS; i++)
+	{
+		if (!s->cat[i].used)
+		{
+			return(i);
+		}
+	}
+	slot = -1;
+	for (i = 0; i < TFT_SLOTS; i++)
+	{
+		if ((i != keep) && ((slot < 0) || (s->cat[i].seq < s->cat[slot].seq)))
+		{
+			slot = i;
+		}
+	}
+	return(slot);
+}
+
+// the CRC of the chunk just finished, onto the end of TFTn.CRC
+static bool sum_put(struct tftstore *s)
+{
+	uint8_t b[4];
+	uint32_t v;
+
+	v = crc32_final(s->sum);
+	b[0] = v & 0xff;
+	b[1] = (v >> 8) & 0xff;
+	b[2] = (v >> 16) & 0xff;
+	b[3] = v >> 24;
+	s->sum = CRC32_INIT;
+	return(fat_write(&s->sums, b, sizeof b));
+}
+
+bool tftstore_begin(struct tftstore *s, const char *model, uint32_t size, uint8_t *buf, uint8_t *sumbuf, int8_t keep)
+{
+	char name[11];
+	int8_t slot;
+
+	if (!s->mounted || (s->slot >= 0))
+	{
+		return(false);
+	}
+	slot = pick_slot(s, model, keep);
+	s->cat[slot].used = 0;		// empty on the card until the new one is all there
+	slot_name(slot, false, name);
+	if (!cat_save(s, buf) || !fat_create(&s->vol, &s->file, name, buf))
+	{
+		return(false);
+	}
+	slot_name(slot, true, name);
+	if (!fat_create(&s->vol, &s->sums, name, sumbuf))
+	{
+		fat_close(&s->file);
+		return(false);
+	}
+	memset(&s->cat[slot], 0, sizeof s->cat[slot]);
+	strncpy(s->cat[slot].model, model, TFT_MODEL_LEN - 1);
+	s->slot = slot;
+	s->crc = CRC32_INIT;
+	s->sum = CRC32_INIT;
+	s->want = size;
+	return(true);
+}
+
+bool tftstore_put(struct tftstore *s, const uint8_t *p, uint16_t n)
+{
+	uint16_t k;
+
+	if (s->slot < 0)
+	{
+		return(false);
+	}
+	while (n)
+	{
+		k = TFT_CHUNK - (uint16_t)(s->file.pos & (TFT_CHUNK - 1));		// up to the end of this chunk
+		if (k > n)
+		{
+			k = n;
+		}
+		s->crc = crc32_block(s->crc, p, k);
+		s->sum = crc32_block(s->sum, p, k);
+		if (!fat_write(&s->file, p, k) || (((s->file.pos & (TFT_CHUNK - 1)) == 0) && !sum_put(s)))
+		{
+			tftstore_abort(s);
+			return(false);
+		}
+		p += k;
+		n -= k;
+	}
+	return(true);
+}
+
+int8_t tftstore_end(struct tftstore *s)
+{
+	struct tft_entry *e;
+	uint32_t seq;
+	int8_t i, slot;
+	bool ok;
+
+	slot = s->slot;
+	if (slot < 0)
+	{
+		return(-1);
+	}
+	s->slot = -1;
+	ok = ((s->file.pos & (TFT_CHUNK - 1)) == 0) || sum_put(s);		// the short one at the end
+	ok = fat_close(&s->sums) && ok;
+	if (!fat_close(&s->file) || !ok || (s->file.size != s->want) || (s->want == 0))
+	{
+		return(-1);
+	}
+	seq = 0;
+	for (i = 0; i < TFT_SLOTS; i++)
+	{
+		if (s->cat[i].used && (s->cat[i].seq >= seq))
+		{
+			seq = s->cat[i].seq + 1;
+		}
+	}
+	e = &s->cat[slot];
+	e->seq = seq;
+	e->size = s->file.size;
+	e->crc = crc32_final(s->crc);
+	e->used = 1;
+	if (!cat_save(s, s->file.buf))
+	{
+		e->used = 0;
+		return(-1);
+	}
+	return(slot);
+}
+
+void tftstore_abort(struct tftstore *s)
+{
+	if (s->slot >= 0)
+	{
+		s->slot = -1;
+		fat_close(&s->sums);		// keep the FAT straight, the catalogue already says empty
+		fat_close(&s->file);
+	}
+}
+
+bool tftstore_open(struct tftstore *s, int8_t slot, bool sums, struct fat_file *f, uint8_t *buf)
+{
+	char name[11];
+	uint32_t size;
+
+	if (!s->mounted || (slot < 0) || (slot >= TFT_SLOTS) || !s->cat[slot].used)
+	{
+		return(false);
+	}
+	slot_name(slot, sums, name);
+	size = sums ? TFT_CHUNKS(s->cat[slot].size) * 4 : s->cat[slot].size;		// none from before there were sums
+	return(fat_open(&s->vol, f, name, buf) && (f->size == size));
+}
@@ -0,0 +1,72 @@
+// Catalogue of TFT images kept on the SD card
+//
+// Images go in TFT0.BIN .. TFT7.BIN in the root directory; TFTCAT.BIN
+// holds one tft_entry per slot saying what is in it: the size, CRC-32 and
+// the display model it was sent to (from the comok reply). An image being
+// captured is only entered once all of it has been written, so a slot
+// that was cut short reads as empty. Beside each image, TFTn.CRC holds
+// the CRC-32 of every TFT_CHUNK bytes of it in turn, so a delta upload
+// (delta_proto.h) can tell which chunks a new file changes without reading
+// the old one.
+// Builds on a PC as well, see tools/tftstore.
+
+#ifndef TFTSTORE_H_INCLUDED
+#define TFTSTORE_H_INCLUDED
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "fat32.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TFT_SLOTS		8
+#define TFT_MODEL_LEN	24		// NX4832T035_011R and the like, 0 padded
+#define TFT_CHUNK		4096	// bytes per CRC in TFTn.CRC, the display's upload chunk
+
+// on the card as it is in RAM: little endian, no padding on AVR or a PC
+struct tft_entry {
+	uint32_t seq;					// capture order, higher is newer
+	uint32_t size;					// bytes
+	uint32_t crc;					// CRC-32 of them
+	char model[TFT_MODEL_LEN];
+	uint8_t used;
+	uint8_t spare[3];
+};
+
+struct tftstore {
+	struct fat_vol vol;
+	struct fat_file file;			// the image being captured
+	struct fat_file sums;			// and its chunk CRCs
+	struct tft_entry cat[TFT_SLOTS];
+	bool mounted;
+	int8_t slot;					// being captured, -1 for none
+	uint32_t crc;					// of what has been captured so far
+	uint32_t sum;					// of the chunk being captured
+	uint32_t want;					// bytes the capture should come to
+};
+
+#define TFT_CHUNKS(size)	(((size) + TFT_CHUNK - 1) / TFT_CHUNK)
+
+// comok reply -> model name, "" if there is none
+void tft_model(const char *sig, char *model);
+
+bool tftstore_mount(struct tftstore *s, const struct blockdev *dev, uint8_t *win, uint8_t *buf);
+int8_t tftstore_find(const struct tftstore *s, const char *model);	// newest image for a model, -1 for none
+int8_t tftstore_match(const struct tftstore *s, const char *model, uint32_t size, uint32_t crc);	// exactly that one
+
+// keep is a slot not to write over (one being read from), -1 for none
+bool tftstore_begin(struct tftstore *s, const char *model, uint32_t size, uint8_t *buf, uint8_t *sumbuf, int8_t keep);
+bool tftstore_put(struct tftstore *s, const uint8_t *p, uint16_t n);	// false when the capture has been dropped
+int8_t tftstore_end(struct tftstore *s);	// slot it went in, -1 if it was short or failed
+void tftstore_abort(struct tftstore *s);
+
+// read a slot back with fat_read_sector(f): the image, or with sums its chunk CRCs
+bool tftstore_open(struct tftstore *s, int8_t slot, bool sums, struct fat_file *f, uint8_t *buf);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TFTSTORE_H_INCLUDED */
@@ -0,0 +1,41 @@
+// Fine grained time from timer 5, which free-runs at the cpu clock.
+// driver_isr.c moves OCR5A on by TB_CYCLES_PER_MS every 1mS tick, so
+// TCNT5 - OCR5A + TB_CYCLES_PER_MS is the cycle count since the last tick.
+
+#ifndef TIMEBASE_H_INCLUDED
+#define TIMEBASE_H_INCLUDED
+
+#include <compiler.h>
+#include <atomic.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TB_CYCLES_PER_MS	(F_CPU / 1000UL)
+
+extern volatile uint64_t msectimer0;
+
+// timer 5 count; the timer ISR uses the shared TEMP register so
+// main-line code must not be interrupted between the two byte reads
+static inline uint16_t tcnt5(void)
+{
+	uint16_t t;
+
+	ENTER_CRITICAL(T);
+	t = TCNT5;
+	EXIT_CRITICAL(T);
+	return(t);
+}
+
+// cycles since the last 1mS tick; call with interrupts off (e.g. in an ISR)
+static inline uint16_t tb_cycles_in_ms(void)
+{
+	return(TCNT5 - OCR5A + TB_CYCLES_PER_MS);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TIMEBASE_H_INCLUDED */
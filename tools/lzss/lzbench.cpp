@@ -0,0 +1,165 @@
+// Host benchmark for packed uploads: nexdelta's packer (lzpack.h) and the
+// firmware's own unpacker (lzss.c)
+//
+// Packs each file a 4096 byte chunk at a time as nexdelta -z does, unpacks
+// it again a byte at a time as the bridge does, checks it comes back the
+// same and prints the ratio, both speeds, and what it saves on the PC link.
+// With no files it makes a stand in: runs of colour with some noise and
+// text-like tables, about as packable as a TFT's pictures and fonts.
+//
+// Build: g++ -O2 -Wall -o lzbench lzbench.cpp -x c "../../async serial transfer/lzss.c"
+// Usage: lzbench [-b baud] [file.tft ...]
+//   -b  PC link baud for the time saved (default 115200)
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include <unistd.h>
+
+#include "lzpack.h"
+#include "../../async serial transfer/delta_proto.h"
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+double seconds_since(clock_type::time_point t)
+{
+	return std::chrono::duration<double>(clock_type::now() - t).count();
+}
+
+std::vector<uint8_t> stand_in(size_t size)
+{
+	std::mt19937 rng(1);
+	std::vector<uint8_t> d;
+	while (d.size() < size) {
+		switch (rng() % 4) {
+		case 0:
+		case 1: {		// a run of one 16 bit colour
+			uint8_t lo = rng(), hi = rng();
+			for (unsigned n = 200 + rng() % 4000; n; n--) {
+				d.push_back(lo);
+				d.push_back(hi);
+			}
+			break;
+		}
+		case 2:			// noisy picture
+			for (unsigned n = 100 + rng() % 1500; n; n--)
+				d.push_back(rng());
+			break;
+		default:		// glyph rows, a few values repeating
+			for (unsigned n = 500 + rng() % 3000; n; n--)
+				d.push_back((rng() % 5) * 0x33);
+			break;
+		}
+	}
+	d.resize(size);
+	return d;
+}
+
+bool bench(const char *name, const std::vector<uint8_t> &data, long baud)
+{
+	const size_t chunks = (data.size() + DLT_CHUNK - 1) / DLT_CHUNK;
+	std::vector<std::vector<uint8_t>> packed(chunks);
+	size_t total = 0, raw = 0;
+
+	auto t0 = clock_type::now();
+	lz_packer packer(data);
+	for (size_t i = 0; i < chunks; i++) {
+		size_t at = i * DLT_CHUNK, end = at + DLT_CHUNK < data.size() ? at + DLT_CHUNK : data.size();
+		packed[i] = packer.pack(at, end);
+		if (packed[i].size() >= end - at) {		// sent as it is, as nexdelta would
+			packed[i].clear();
+			raw++;
+			total += end - at;
+		} else {
+			total += packed[i].size();
+		}
+		total += 2;		// the length in front
+	}
+	double pack_s = seconds_since(t0);
+
+	std::vector<uint8_t> out(data.size());
+	uint8_t win[LZ_WINDOW];
+	struct lz z;
+	t0 = clock_type::now();
+	lz_init(&z, win);
+	for (size_t i = 0; i < chunks; i++) {
+		size_t at = i * DLT_CHUNK, end = at + DLT_CHUNK < data.size() ? at + DLT_CHUNK : data.size();
+		const std::vector<uint8_t> &in = packed[i];
+		size_t used = 0;
+		lz_restart(&z);
+		for (size_t p = at; p < end; p++) {
+			if (in.empty()) {
+				out[p] = data[p];
+				lz_keep(&z, out[p]);
+				continue;
+			}
+			while (lz_wants(&z)) {
+				if (used == in.size()) {
+					fprintf(stderr, "lzbench: %s: chunk %zu ran out at byte %zu\n", name, i, p - at);
+					return false;
+				}
+				lz_feed(&z, in[used++]);
+			}
+			out[p] = lz_out(&z);
+		}
+		if (used != in.size()) {
+			fprintf(stderr, "lzbench: %s: chunk %zu left %zu bytes over\n", name, i, in.size() - used);
+			return false;
+		}
+	}
+	double unpack_s = seconds_since(t0);
+	if (out != data) {
+		fprintf(stderr, "lzbench: %s: unpacked data differs\n", name);
+		return false;
+	}
+
+	double mb = data.size() / 1e6, bps = baud / 10.0;
+	printf("%s: %zu bytes -> %zu (%.1f%%), %zu of %zu chunks raw\n", name, data.size(), total,
+	       100.0 * total / data.size(), raw, chunks);
+	printf("  pack %.1f MB/s  unpack %.1f MB/s\n", mb / pack_s, mb / unpack_s);
+	printf("  @ %ld baud: %.1f s whole, %.1f s packed\n", baud, data.size() / bps, total / bps);
+	return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+	long baud = 115200;
+	int c;
+	while ((c = getopt(argc, argv, "b:")) != -1) {
+		switch (c) {
+		case 'b': baud = strtol(optarg, nullptr, 10); break;
+		default:
+			fprintf(stderr, "usage: %s [-b baud] [file ...]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	bool ok = true;
+	if (optind == argc)
+		return bench("stand in", stand_in(4 << 20), baud) ? 0 : 1;
+	for (int i = optind; i < argc; i++) {
+		FILE *fp = fopen(argv[i], "rb");
+		if (!fp) {
+			perror(argv[i]);
+			ok = false;
+			continue;
+		}
+		std::vector<uint8_t> data;
+		uint8_t buf[4096];
+		size_t n;
+		while ((n = fread(buf, 1, sizeof buf, fp)) > 0)
+			data.insert(data.end(), buf, buf + n);
+		fclose(fp);
+		ok = bench(argv[i], data, baud) && ok;
+	}
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,110 @@
+// LZSS packing for nexdelta, the format the bridge unpacks (lzss.h)
+//
+// Each chunk is packed on its own, but with the LZ_WINDOW bytes of the
+// file before it (zeros before the start) as history, since that is what
+// the bridge's window holds when it gets there, from the PC or its card.
+// Greedy longest match, found through hash chains over the window.
+
+#ifndef LZPACK_H_INCLUDED
+#define LZPACK_H_INCLUDED
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "../../async serial transfer/lzss.h"
+
+class lz_packer {
+public:
+	explicit lz_packer(const std::vector<uint8_t> &file)
+	    : buf_(LZ_WINDOW, 0), head_(1 << 16, 0)
+	{
+		buf_.insert(buf_.end(), file.begin(), file.end());
+		memset(prev_, 0, sizeof prev_);
+	}
+
+	// file bytes [at, end), packed
+	std::vector<uint8_t> pack(size_t at, size_t end)
+	{
+		const uint32_t p0 = static_cast<uint32_t>(at + LZ_WINDOW), p1 = static_cast<uint32_t>(end + LZ_WINDOW);
+		std::vector<uint8_t> out;
+		size_t flagpos = 0;
+		int items = 8;
+
+		// the window's positions, unless they went in packing the chunk before
+		for (uint32_t p = (next_ > p0 - LZ_WINDOW && next_ <= p0) ? next_ : p0 - LZ_WINDOW; p < p0; p++)
+			insert(p);
+		for (uint32_t p = p0; p < p1;) {
+			if (items == 8) {
+				flagpos = out.size();
+				out.push_back(0);
+				items = 0;
+			}
+			uint32_t dist = 0, len = longest(p, p1, dist);
+			if (len >= LZ_MIN_MATCH) {
+				out.push_back(static_cast<uint8_t>(dist - 1));
+				out.push_back(static_cast<uint8_t>(len - LZ_MIN_MATCH));
+				for (uint32_t k = 0; k < len; k++)
+					insert(p + k);
+				p += len;
+			} else {
+				out[flagpos] |= 1 << items;
+				out.push_back(buf_[p]);
+				insert(p);
+				p++;
+			}
+			items++;
+		}
+		next_ = p1;
+		return out;
+	}
+
+private:
+	static const int max_chain = 64;
+
+	std::vector<uint8_t> buf_;		// LZ_WINDOW zeros, then the file
+	std::vector<uint32_t> head_;	// newest position for each hash
+	uint32_t prev_[LZ_WINDOW];		// the one before it with that hash, by position in the window
+	uint32_t next_ = 0;				// the position after the last one inserted
+
+	uint16_t hash(uint32_t p) const
+	{
+		return static_cast<uint16_t>((buf_[p] << 8 | buf_[p + 1]) ^ (buf_[p + 2] * 0x9e));
+	}
+
+	void insert(uint32_t p)
+	{
+		if (p + 2 >= buf_.size())
+			return;
+		uint16_t h = hash(p);
+		prev_[p % LZ_WINDOW] = head_[h];
+		head_[h] = p;
+	}
+
+	// longest match for p in the window that stops by end, 0 for none
+	uint32_t longest(uint32_t p, uint32_t end, uint32_t &dist) const
+	{
+		uint32_t best = 0, most = end - p < LZ_MAX_MATCH ? end - p : LZ_MAX_MATCH;
+		if (most < LZ_MIN_MATCH || p + 2 >= buf_.size())
+			return 0;
+		uint32_t cand = head_[hash(p)];
+		for (int n = 0; n < max_chain && cand < p && p - cand <= LZ_WINDOW; n++) {
+			uint32_t len = 0;
+			while (len < most && buf_[cand + len] == buf_[p + len])		// may run on into p, as the bridge's copy does
+				len++;
+			if (len > best) {
+				best = len;
+				dist = p - cand;
+				if (len == most)
+					break;
+			}
+			uint32_t older = prev_[cand % LZ_WINDOW];
+			if (older >= cand)
+				break;
+			cand = older;
+		}
+		return best;
+	}
+};
+
+#endif /* LZPACK_H_INCLUDED */
@@ -0,0 +1,363 @@
+// Delta uploads to a Nextion display through the bridge (delta_proto.h)
+//
+// Plays the Editor's part up to the upload: connect, then dlt-wri with the
+// new file's size and CRC, then the CRC-32 of each 4096 byte chunk. The
+// bridge compares them with its stored copy of what the display has and
+// asks for the chunks that changed as it flashes, so only those cross the
+// PC link. When the bridge has nothing stored for the display the whole
+// file goes the Editor's way: whmi-wri, then 4096 byte chunks paced by the
+// display's 0x05. With -z the chunks that do cross are LZSS packed
+// (tools/lzss), and then a bridge with nothing stored takes every chunk
+// that way rather than fall back.
+//
+// Build: g++ -std=c++17 -O2 -Wall -o nexdelta nexdelta.cpp
+// Usage: nexdelta [-b baud] [-u baud] [-n | -z] <tty> <file.tft>
+//   -b  PC link baud, the one the display was found at (default 9600)
+//   -u  baud for the display to take the upload at (default: the fastest
+//       it will for a delta, the link's for a whole upload)
+//   -n  no delta, send the whole file
+//   -z  pack the chunks sent
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "../../async serial transfer/delta_proto.h"
+#include "../lzss/lzpack.h"
+
+namespace {
+
+struct options {
+	long baud = 9600;
+	long up = 0;
+	bool whole = false;
+	bool packed = false;
+	const char *tty = nullptr;
+	const char *file = nullptr;
+};
+
+using clock_type = std::chrono::steady_clock;
+
+double seconds_since(clock_type::time_point t)
+{
+	return std::chrono::duration<double>(clock_type::now() - t).count();
+}
+
+uint32_t crc32(const uint8_t *p, size_t n)
+{
+	uint32_t crc = 0xffffffff;
+	while (n--) {
+		crc ^= *p++;
+		for (int i = 0; i < 8; i++)
+			crc = (crc & 1) ? (crc >> 1) ^ 0xedb88320 : crc >> 1;
+	}
+	return ~crc;
+}
+
+speed_t tty_speed(long baud)
+{
+	switch (baud) {
+	case 2400: return B2400;
+	case 4800: return B4800;
+	case 9600: return B9600;
+	case 19200: return B19200;
+	case 38400: return B38400;
+	case 57600: return B57600;
+	case 115200: return B115200;
+	case 230400: return B230400;
+	default: return B0;
+	}
+}
+
+bool set_baud(int fd, long baud)
+{
+	struct termios tio;
+	speed_t sp = tty_speed(baud);
+	if (sp == B0) {
+		fprintf(stderr, "nexdelta: unsupported baud %ld\n", baud);
+		return false;
+	}
+	if (!isatty(fd))
+		return true;
+	if (tcgetattr(fd, &tio) < 0)
+		return false;
+	cfmakeraw(&tio);
+	cfsetispeed(&tio, sp);
+	cfsetospeed(&tio, sp);
+	tio.c_cc[VMIN] = 0;
+	tio.c_cc[VTIME] = 0;
+	return tcsetattr(fd, TCSADRAIN, &tio) == 0;
+}
+
+// one byte, or -1 after ms of nothing
+int get_byte(int fd, int ms)
+{
+	struct pollfd p = {fd, POLLIN, 0};
+	uint8_t ch;
+	if (poll(&p, 1, ms) <= 0 || read(fd, &ch, 1) != 1)
+		return -1;
+	return ch;
+}
+
+// a little endian number n bytes long, false on a timeout
+bool get_le(int fd, int n, uint32_t &v)
+{
+	v = 0;
+	for (int i = 0; i < n; i++) {
+		int ch = get_byte(fd, 2000);
+		if (ch < 0)
+			return false;
+		v |= static_cast<uint32_t>(ch) << (8 * i);
+	}
+	return true;
+}
+
+bool put(int fd, const void *p, size_t n)
+{
+	const uint8_t *b = static_cast<const uint8_t *>(p);
+	while (n) {
+		ssize_t k = write(fd, b, n);
+		if (k < 0 && errno != EAGAIN)
+			return false;
+		if (k > 0) {
+			b += k;
+			n -= k;
+		}
+	}
+	return true;
+}
+
+bool put_str(int fd, const std::string &s)
+{
+	return put(fd, s.data(), s.size());
+}
+
+void drain(int fd, int ms)
+{
+	while (get_byte(fd, ms) >= 0)
+		;
+}
+
+// connect as the Editor does; true once a comok comes back
+bool connect(int fd)
+{
+	for (int tries = 0; tries < 5; tries++) {
+		drain(fd, 100);
+		if (!put_str(fd, "\xff\xff\xff" "connect\xff\xff\xff"))
+			return false;
+		std::string reply;
+		int ch;
+		while ((ch = get_byte(fd, 1500)) >= 0) {
+			reply.push_back(static_cast<char>(ch));
+			size_t at = reply.find("comok");
+			if (at != std::string::npos && reply.size() >= 3 && reply.compare(reply.size() - 3, 3, "\xff\xff\xff") == 0) {
+				printf("%s\n", reply.substr(at, reply.size() - at - 3).c_str());
+				return true;
+			}
+		}
+	}
+	fprintf(stderr, "nexdelta: no comok from the bridge\n");
+	return false;
+}
+
+// the Editor's way, all of it
+int whole(int fd, const std::vector<uint8_t> &data, long baud)
+{
+	auto t0 = clock_type::now();
+	printf("to check it, on the bridge's shell before it ends: expect %08x %zu\n", crc32(data.data(), data.size()), data.size());
+	if (!put_str(fd, "whmi-wri " + std::to_string(data.size()) + "," + std::to_string(baud) + ",0\xff\xff\xff"))
+		return 1;
+	tcdrain(fd);
+	usleep(50000);
+	if (!set_baud(fd, baud))
+		return 1;
+	for (size_t at = 0; at < data.size(); at += DLT_CHUNK) {
+		int ch;
+		do
+			ch = get_byte(fd, 5000);
+		while (ch >= 0 && ch != 0x05);
+		if (ch < 0) {
+			fprintf(stderr, "nexdelta: no ack for chunk %zu\n", at / DLT_CHUNK);
+			return 1;
+		}
+		size_t n = data.size() - at < DLT_CHUNK ? data.size() - at : DLT_CHUNK;
+		if (!put(fd, &data[at], n))
+			return 1;
+		printf("\r%zu/%zu chunks", at / DLT_CHUNK + 1, (data.size() + DLT_CHUNK - 1) / DLT_CHUNK);
+		fflush(stdout);
+	}
+	if (get_byte(fd, 5000) != 0x05)
+		fprintf(stderr, "\nnexdelta: no ack for the last chunk\n");
+	printf("\n%zu bytes in %.1f s\n", data.size(), seconds_since(t0));
+	return 0;
+}
+
+// DLT_END's status and chunk count, reported; 0 for DLT_OK
+int delta_end(int fd, size_t chunks, size_t bytes, size_t size, clock_type::time_point t0)
+{
+	uint32_t status, fetched;
+	if (!get_le(fd, 1, status) || !get_le(fd, 2, fetched))
+		return 1;
+	static const char *const why[] = {"ok", "display stopped acking", "card read failed",
+	                                  "display took no baud", "PC too slow", "crc mismatch",
+	                                  "bad packing", "bigger than the display's flash",
+	                                  "made for another display model"};
+	printf("\n%s: %u of %zu chunks (%zu of %zu bytes) from the PC in %.1f s\n",
+	       status < sizeof why / sizeof why[0] ? why[status] : "failed", fetched, chunks, bytes,
+	       size, seconds_since(t0));
+	return status == DLT_OK ? 0 : 1;
+}
+
+// returns -1 when the bridge has no base, so the caller sends it all
+int delta(int fd, const std::vector<uint8_t> &data, long up, bool packed)
+{
+	const size_t chunks = (data.size() + DLT_CHUNK - 1) / DLT_CHUNK;
+	auto t0 = clock_type::now();
+	lz_packer packer(data);
+	std::vector<uint8_t> body;		// the packed chunk going out
+	size_t body_at = 0;
+
+	drain(fd, 200);
+	if (!put_str(fd, "dlt-wri " + std::to_string(data.size()) + "," + std::to_string(up) + "," +
+	                     std::to_string(crc32(data.data(), data.size())) + "," +
+	                     std::to_string(packed ? DLT_PACKED : 0) + "\xff\xff\xff"))
+		return 1;
+	int ch;
+	do		// skip whatever the display said about the command going by
+		ch = get_byte(fd, 3000);
+	while (ch >= 0 && ch != DLT_HELLO && ch != DLT_NOBASE && ch != DLT_END);
+	if (ch < 0) {
+		fprintf(stderr, "nexdelta: no answer to dlt-wri\n");
+		return 1;
+	}
+	if (ch == DLT_NOBASE) {
+		printf("nothing stored to work from, sending it all\n");
+		return -1;
+	}
+	if (ch == DLT_END)		// refused before anything was sent
+		return delta_end(fd, chunks, 0, data.size(), t0);
+	uint32_t base;
+	if (!get_le(fd, 2, base))
+		return 1;
+	printf("stored image %u chunks, new %zu\n", base, chunks);
+
+	std::vector<uint8_t> sums;
+	for (size_t i = 0; i < chunks; i++) {
+		size_t at = i * DLT_CHUNK;
+		uint32_t v = crc32(&data[at], data.size() - at < DLT_CHUNK ? data.size() - at : DLT_CHUNK);
+		for (int j = 0; j < 4; j++)
+			sums.push_back((v >> (8 * j)) & 0xff);
+	}
+	if (!put(fd, sums.data(), sums.size()))
+		return 1;
+
+	size_t sent = 0, bytes = 0;
+	for (;;) {		// the display's baud switch and every stored chunk go by before the next request
+		ch = get_byte(fd, 30000);
+		if (ch < 0) {
+			fprintf(stderr, "\nnexdelta: bridge went quiet\n");
+			return 1;
+		}
+		if (ch == DLT_WANT) {
+			uint32_t idx;
+			if (!get_le(fd, 2, idx) || idx >= chunks) {
+				fprintf(stderr, "\nnexdelta: bad chunk request\n");
+				return 1;
+			}
+			size_t at = idx * DLT_CHUNK;
+			size_t n = data.size() - at < DLT_CHUNK ? data.size() - at : DLT_CHUNK;
+			sent++;
+			printf("\rsent chunk %u, %zu so far", idx, sent);
+			fflush(stdout);
+			if (!packed) {
+				if (!put(fd, &data[at], n))
+					return 1;
+				bytes += n;
+				continue;
+			}
+			body = packer.pack(at, at + n);
+			if (body.size() >= n)		// doesn't pack, goes as it is
+				body.assign(&data[at], &data[at] + n);
+			uint8_t len[2] = {static_cast<uint8_t>(body.size() == n ? 0 : body.size() & 0xff),
+			                  static_cast<uint8_t>(body.size() == n ? 0 : body.size() >> 8)};
+			body_at = body.size() < DLT_CREDITS * DLT_CREDIT ? body.size() : DLT_CREDITS * DLT_CREDIT;
+			if (!put(fd, len, 2) || !put(fd, body.data(), body_at))
+				return 1;
+			bytes += 2 + body_at;
+		} else if (ch == DLT_MORE) {
+			size_t n = body.size() - body_at < DLT_CREDIT ? body.size() - body_at : DLT_CREDIT;
+			if (!put(fd, &body[body_at], n))
+				return 1;
+			body_at += n;
+			bytes += n;
+		} else if (ch == DLT_END) {
+			return delta_end(fd, chunks, bytes, data.size(), t0);
+		}
+	}
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+	options opt;
+	int c;
+	while ((c = getopt(argc, argv, "b:u:nz")) != -1) {
+		switch (c) {
+		case 'b': opt.baud = strtol(optarg, nullptr, 10); break;
+		case 'u': opt.up = strtol(optarg, nullptr, 10); break;
+		case 'n': opt.whole = true; break;
+		case 'z': opt.packed = true; break;
+		default:
+			fprintf(stderr, "usage: %s [-b baud] [-u baud] [-n | -z] <tty> <file.tft>\n", argv[0]);
+			return 2;
+		}
+	}
+	if (optind != argc - 2) {
+		fprintf(stderr, "usage: %s [-b baud] [-u baud] [-n | -z] <tty> <file.tft>\n", argv[0]);
+		return 2;
+	}
+	opt.tty = argv[optind];
+	opt.file = argv[optind + 1];
+
+	FILE *fp = fopen(opt.file, "rb");
+	if (!fp) {
+		fprintf(stderr, "nexdelta: %s: %s\n", opt.file, strerror(errno));
+		return 1;
+	}
+	std::vector<uint8_t> data;
+	uint8_t buf[4096];
+	size_t n;
+	while ((n = fread(buf, 1, sizeof buf, fp)) > 0)
+		data.insert(data.end(), buf, buf + n);
+	fclose(fp);
+	if (data.empty() || data.size() > static_cast<size_t>(DLT_MAX_CHUNKS) * DLT_CHUNK) {
+		fprintf(stderr, "nexdelta: %s: %zu bytes, want 1..%u\n", opt.file, data.size(), DLT_MAX_CHUNKS * DLT_CHUNK);
+		return 1;
+	}
+
+	int fd = open(opt.tty, O_RDWR | O_NOCTTY);
+	if (fd < 0) {
+		fprintf(stderr, "nexdelta: %s: %s\n", opt.tty, strerror(errno));
+		return 1;
+	}
+	if (!set_baud(fd, opt.baud) || !connect(fd)) {
+		close(fd);
+		return 1;
+	}
+	int rc = opt.whole ? -1 : delta(fd, data, opt.up, opt.packed);
+	if (rc < 0)
+		rc = whole(fd, data, opt.up ? opt.up : opt.baud);
+	close(fd);
+	return rc;
+}
@@ -0,0 +1,60 @@
+#!/bin/sh
+# Static SRAM budget per module for the bridge firmware
+#
+# Lists .data + .bss of every object file in an Atmel Studio build
+# directory (by path in it, src/embedded_tft.o apart from embedded_tft.o),
+# largest first, then checks the total against the Mega's 8KB and the
+# stack reserve. The .cproj runs it after every build where there is a sh;
+# it exits non-zero when the statics leave less than the reserve for the
+# stack, which fails the build, or when avr-size can't be run.
+#
+# Usage: ram_budget.sh [build dir (default: "async serial transfer/Debug")] [stack reserve bytes (default 1024)]
+# Needs avr-size from the avr-gcc toolchain on the PATH (or AVR_SIZE=...).
+
+DIR=${1:-"async serial transfer/Debug"}
+RESERVE=${2:-1024}
+SIZE=${AVR_SIZE:-avr-size}
+RAM=8192
+
+if [ ! -d "$DIR" ]; then
+	echo "ram_budget: no build directory $DIR" >&2
+	exit 2
+fi
+
+# from inside it, so the names come out relative to it
+ROWS=$(cd "$DIR" && find . -name '*.o' -print0 | xargs -0 "$SIZE" -B)
+if [ $? -ne 0 ] || [ -z "$(printf '%s\n' "$ROWS" | sed 1d)" ]; then
+	echo "ram_budget: $SIZE gave no sizes for $DIR" >&2
+	exit 2
+fi
+
+printf '%s\n' "$ROWS" | awk -v ram="$RAM" -v reserve="$RESERVE" '
+	NR == 1 { next }				# avr-size header line
+	{
+		mod = $6
+		for (i = 7; i <= NF; i++) mod = mod " " $i	# paths with spaces
+		sub(/^\.[\/\\]/, "", mod)			# from find .
+		used = $2 + $3
+		if (used == 0) next
+		line[mod] = sprintf("%-32s %6d %6d %6d", mod, $2, $3, used)
+		size[mod] = used
+		total += used
+		data += $2
+		bss += $3
+	}
+	END {
+		printf("%-32s %6s %6s %6s\n", "module", "data", "bss", "ram")
+		while (length(size) > 0) {
+			best = ""
+			for (m in size) if (best == "" || size[m] > size[best]) best = m
+			print line[best]
+			delete size[best]
+		}
+		printf("%-32s %6d %6d %6d\n", "total", data, bss, total)
+		left = ram - total
+		printf("\n%d of %d bytes static, %d left for heap and stack (reserve %d)\n", total, ram, left, reserve)
+		if (left < reserve) {
+			print "ram_budget: over budget" > "/dev/stderr"
+			exit 1
+		}
+	}'
@@ -0,0 +1,265 @@
+// Host decoder for the bridge's binary telemetry stream on USART3
+//
+// Reads a captured stream from a file, or live from a tty/pty, splits it
+// on 0x00 delimiters, COBS decodes and crc checks each frame and prints
+// the status fields either as a readable block or as one CSV row per frame.
+//
+// Build: g++ -std=c++17 -O2 -Wall -o teledec teledec.cpp
+// Usage: teledec [-c] [-t] [-b baud] <capture file | /dev/ttyUSBn>
+//   -c  CSV output (header line first)
+//   -t  also print any debug text found between frames (to stderr)
+//   -b  baud rate when reading a tty (default 9600)
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "../../async serial transfer/telemetry_frame.h"
+
+namespace {
+
+const char *const phase_names[TLM_NPHASES] = {"find", "connect", "waitup", "upload"};
+
+struct options {
+	bool csv = false;
+	bool text = false;
+	long baud = 9600;
+	const char *path = nullptr;
+};
+
+uint16_t get16(const uint8_t *p)
+{
+	return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+uint32_t get32(const uint8_t *p)
+{
+	return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+	       (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+uint16_t crc16_ccitt(const uint8_t *p, size_t n)
+{
+	uint16_t crc = 0xffff;
+	while (n--) {
+		crc ^= static_cast<uint16_t>(*p++) << 8;
+		for (int i = 0; i < 8; i++)
+			crc = (crc & 0x8000) ? static_cast<uint16_t>((crc << 1) ^ 0x1021) : static_cast<uint16_t>(crc << 1);
+	}
+	return crc;
+}
+
+// decode one delimiter-free COBS block, false if it is malformed
+bool cobs_decode(const std::vector<uint8_t> &in, std::vector<uint8_t> &out)
+{
+	out.clear();
+	size_t i = 0;
+	while (i < in.size()) {
+		uint8_t code = in[i++];
+		if (code == 0 || i + code - 1 > in.size())
+			return false;
+		out.insert(out.end(), in.begin() + i, in.begin() + i + code - 1);
+		i += code - 1;
+		if (code != 0xff && i < in.size())
+			out.push_back(0);
+	}
+	return true;
+}
+
+speed_t tty_speed(long baud)
+{
+	switch (baud) {
+	case 2400: return B2400;
+	case 4800: return B4800;
+	case 9600: return B9600;
+	case 19200: return B19200;
+	case 38400: return B38400;
+	case 57600: return B57600;
+	case 115200: return B115200;
+	case 230400: return B230400;
+	default: return B0;
+	}
+}
+
+bool setup_tty(int fd, long baud)
+{
+	struct termios tio;
+	if (!isatty(fd))
+		return true;
+	if (tcgetattr(fd, &tio) < 0)
+		return false;
+	cfmakeraw(&tio);
+	speed_t sp = tty_speed(baud);
+	if (sp == B0) {
+		fprintf(stderr, "teledec: unsupported baud %ld\n", baud);
+		return false;
+	}
+	cfsetispeed(&tio, sp);
+	cfsetospeed(&tio, sp);
+	tio.c_cc[VMIN] = 1;
+	tio.c_cc[VTIME] = 0;
+	return tcsetattr(fd, TCSANOW, &tio) == 0;
+}
+
+void print_csv_header()
+{
+	printf("uptime_ms,phase");
+	for (int p = 0; p < TLM_NPORTS; p++)
+		printf(",u%d_rx,u%d_tx,u%d_rxovf,u%d_rxerr,u%d_rxused,u%d_txused,u%d_rxhwm,u%d_txhwm,u%d_rxsize,u%d_txsize",
+		       p, p, p, p, p, p, p, p, p, p);
+	for (int i = 0; i < TLM_NPHASES; i++)
+		printf(",%s_ms", phase_names[i]);
+	printf(",up_total,up_sent,up_acks,log_dropped,up_rate,up_baud,ack_min,ack_avg,ack_max\n");
+}
+
+void print_status(const uint8_t *f, bool csv)
+{
+	uint8_t phase = f[TLM_OFF_PHASE];
+	const char *pname = phase < TLM_NPHASES ? phase_names[phase] : "?";
+
+	if (csv) {
+		printf("%u,%s", get32(f + TLM_OFF_UPTIME), pname);
+		for (int p = 0; p < TLM_NPORTS; p++) {
+			const uint8_t *b = f + TLM_OFF_PORTS + p * TLM_PORT_SIZE;
+			printf(",%u,%u,%u,%u,%u,%u,%u,%u,%u,%u", get32(b + TLM_PORT_RXBYTES), get32(b + TLM_PORT_TXBYTES),
+			       get16(b + TLM_PORT_RXOVF), get16(b + TLM_PORT_RXERR), get16(b + TLM_PORT_RXUSED),
+			       get16(b + TLM_PORT_TXUSED), get16(b + TLM_PORT_RXHWM), get16(b + TLM_PORT_TXHWM),
+			       get16(b + TLM_PORT_RXSIZE), get16(b + TLM_PORT_TXSIZE));
+		}
+		for (int i = 0; i < TLM_NPHASES; i++)
+			printf(",%u", get32(f + TLM_OFF_PHASEMS + i * 4));
+		printf(",%u,%u,%u,%u,%u,%u,%u,%u,%u\n", get32(f + TLM_OFF_UPTOTAL), get32(f + TLM_OFF_UPSENT),
+		       get16(f + TLM_OFF_UPACKS), get16(f + TLM_OFF_LOGDROP), get32(f + TLM_OFF_UPRATE),
+		       get32(f + TLM_OFF_UPBAUD), get16(f + TLM_OFF_ACKMIN), get16(f + TLM_OFF_ACKAVG),
+		       get16(f + TLM_OFF_ACKMAX));
+		fflush(stdout);
+		return;
+	}
+
+	printf("t=%u ms  phase=%s\n", get32(f + TLM_OFF_UPTIME), pname);
+	for (int p = 0; p < TLM_NPORTS; p++) {
+		const uint8_t *b = f + TLM_OFF_PORTS + p * TLM_PORT_SIZE;
+		printf("  usart%d rx=%-10u tx=%-10u ovf=%-5u err=%-5u ring rx %4u/%-4u (hwm %4u) tx %4u/%-4u (hwm %4u)\n",
+		       p, get32(b + TLM_PORT_RXBYTES), get32(b + TLM_PORT_TXBYTES), get16(b + TLM_PORT_RXOVF),
+		       get16(b + TLM_PORT_RXERR), get16(b + TLM_PORT_RXUSED), get16(b + TLM_PORT_RXSIZE),
+		       get16(b + TLM_PORT_RXHWM), get16(b + TLM_PORT_TXUSED), get16(b + TLM_PORT_TXSIZE),
+		       get16(b + TLM_PORT_TXHWM));
+	}
+	printf("  phase ms:");
+	for (int i = 0; i < TLM_NPHASES; i++)
+		printf(" %s=%u", phase_names[i], get32(f + TLM_OFF_PHASEMS + i * 4));
+	uint32_t total = get32(f + TLM_OFF_UPTOTAL);
+	uint32_t sent = get32(f + TLM_OFF_UPSENT);
+	printf("\n  upload %u/%u bytes", sent, total);
+	if (total)
+		printf(" (%.1f%%)", 100.0 * sent / total);
+	printf(" acks=%u  log dropped=%u\n", get16(f + TLM_OFF_UPACKS), get16(f + TLM_OFF_LOGDROP));
+	uint32_t rate = get32(f + TLM_OFF_UPRATE);
+	uint32_t line = get32(f + TLM_OFF_UPBAUD) / 10;
+	printf("  rate %u B/s of %u B/s line", rate, line);
+	if (rate && total > sent)
+		printf(", eta %u s", (total - sent) / rate);
+	printf("  ack ms min/avg/max %u/%u/%u\n\n", get16(f + TLM_OFF_ACKMIN), get16(f + TLM_OFF_ACKAVG),
+	       get16(f + TLM_OFF_ACKMAX));
+	fflush(stdout);
+}
+
+// returns false for anything that is not a good frame
+bool handle_frame(const std::vector<uint8_t> &raw, const options &opt, unsigned long &bad)
+{
+	std::vector<uint8_t> f;
+	if (!cobs_decode(raw, f) || f.size() < 2 + TLM_CRC_LEN)
+		return false;
+	size_t n = f.size() - TLM_CRC_LEN;
+	uint16_t want = static_cast<uint16_t>((f[n] << 8) | f[n + 1]);
+	if (crc16_ccitt(f.data(), n) != want) {
+		bad++;
+		return false;
+	}
+	if (f[TLM_OFF_TYPE] == TLM_TYPE_STATUS && f[TLM_OFF_VERSION] == TLM_VERSION && n >= TLM_STATUS_LEN) {
+		print_status(f.data(), opt.csv);
+		return true;
+	}
+	fprintf(stderr, "teledec: skipped frame type %u version %u\n", f[TLM_OFF_TYPE], f[TLM_OFF_VERSION]);
+	return true;
+}
+
+void handle_text(const std::vector<uint8_t> &raw)
+{
+	std::string s;
+	for (uint8_t c : raw)
+		if (c == '\n' || (c >= 0x20 && c < 0x7f))
+			s.push_back(static_cast<char>(c));
+	if (!s.empty())
+		fputs(s.c_str(), stderr);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+	options opt;
+	int c;
+	while ((c = getopt(argc, argv, "ctb:")) != -1) {
+		switch (c) {
+		case 'c': opt.csv = true; break;
+		case 't': opt.text = true; break;
+		case 'b': opt.baud = strtol(optarg, nullptr, 10); break;
+		default:
+			fprintf(stderr, "usage: %s [-c] [-t] [-b baud] <file|tty>\n", argv[0]);
+			return 2;
+		}
+	}
+	if (optind != argc - 1) {
+		fprintf(stderr, "usage: %s [-c] [-t] [-b baud] <file|tty>\n", argv[0]);
+		return 2;
+	}
+	opt.path = argv[optind];
+
+	int fd = open(opt.path, O_RDONLY | O_NOCTTY);
+	if (fd < 0) {
+		fprintf(stderr, "teledec: %s: %s\n", opt.path, strerror(errno));
+		return 1;
+	}
+	if (!setup_tty(fd, opt.baud)) {
+		fprintf(stderr, "teledec: cannot set up %s\n", opt.path);
+		return 1;
+	}
+
+	if (opt.csv)
+		print_csv_header();
+
+	std::vector<uint8_t> seg;
+	unsigned long frames = 0, bad = 0;
+	uint8_t buf[512];
+	ssize_t n;
+	while ((n = read(fd, buf, sizeof buf)) > 0) {
+		for (ssize_t i = 0; i < n; i++) {
+			if (buf[i] != 0) {
+				seg.push_back(buf[i]);
+				continue;
+			}
+			if (!seg.empty()) {
+				if (handle_frame(seg, opt, bad))
+					frames++;
+				else if (opt.text)
+					handle_text(seg);
+			}
+			seg.clear();
+		}
+	}
+	if (opt.text && !seg.empty())
+		handle_text(seg);
+	close(fd);
+
+	fprintf(stderr, "teledec: %lu frames, %lu crc errors\n", frames, bad);
+	return 0;
+}
@@ -0,0 +1,300 @@
+// Host side of the bridge's SD card TFT store
+//
+// Runs the firmware's own FAT32 and catalogue code (fat32.c, tftstore.c,
+// crc32.c) against a disk image file, or a card reader's block device, so
+// the store can be checked on a PC and images added or pulled off a card.
+//
+// Build: g++ -O2 -Wall -o tftstore tftstore.cpp -x c "../../async serial transfer/"{crc32,fat32,tftstore}.c
+// Usage: tftstore <image> format <MB>              new FAT32 image, no partition table
+//        tftstore <image> ls                       the catalogue
+//        tftstore <image> put <model|comok...> <file.tft>
+//        tftstore <image> get <slot> <file.tft>     copy out, checking the CRC
+//        tftstore <image> check                    read back every image and check its CRCs
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../../async serial transfer/crc32.h"
+#include "../../async serial transfer/tftstore.h"
+
+namespace {
+
+uint8_t win[BLOCK_SIZE], buf[BLOCK_SIZE], sumbuf[BLOCK_SIZE];
+tftstore store;
+
+bool img_read(void *ctx, uint32_t lba, uint8_t *p)
+{
+	int fd = *static_cast<int *>(ctx);
+	return pread(fd, p, BLOCK_SIZE, static_cast<off_t>(lba) * BLOCK_SIZE) == BLOCK_SIZE;
+}
+
+bool img_write(void *ctx, uint32_t lba, const uint8_t *p)
+{
+	int fd = *static_cast<int *>(ctx);
+	return pwrite(fd, p, BLOCK_SIZE, static_cast<off_t>(lba) * BLOCK_SIZE) == BLOCK_SIZE;
+}
+
+void put16(uint8_t *p, uint16_t v)
+{
+	p[0] = v & 0xff;
+	p[1] = v >> 8;
+}
+
+void put32(uint8_t *p, uint32_t v)
+{
+	for (int i = 0; i < 4; i++)
+		p[i] = (v >> (8 * i)) & 0xff;
+}
+
+// a plain FAT32 volume: boot sector at 0, FSInfo at 1, backup boot at 6
+int format(int fd, long mb)
+{
+	const uint32_t total = static_cast<uint32_t>(mb) * 2048;
+	const uint16_t reserved = 32;
+	const uint8_t spc = 1, nfats = 2;
+	const uint32_t fat_size = ((total - reserved) / spc + 2) * 4 / BLOCK_SIZE + 1;
+
+	if (mb < 40 || mb > 2048) {
+		fprintf(stderr, "tftstore: %ld MB, want 40..2048\n", mb);
+		return 1;
+	}
+	if (ftruncate(fd, 0) < 0 || ftruncate(fd, static_cast<off_t>(total) * BLOCK_SIZE) < 0) {
+		fprintf(stderr, "tftstore: %s\n", strerror(errno));
+		return 1;
+	}
+
+	uint8_t b[BLOCK_SIZE] = {};
+	b[0] = 0xeb; b[1] = 0x58; b[2] = 0x90;
+	memcpy(&b[3], "TFTSTORE", 8);
+	put16(&b[11], BLOCK_SIZE);
+	b[13] = spc;
+	put16(&b[14], reserved);
+	b[16] = nfats;
+	b[21] = 0xf8;
+	put16(&b[24], 63);
+	put16(&b[26], 255);
+	put32(&b[32], total);
+	put32(&b[36], fat_size);
+	put32(&b[44], 2);		// root directory
+	put16(&b[48], 1);		// FSInfo
+	put16(&b[50], 6);		// backup boot sector
+	b[64] = 0x80;
+	b[66] = 0x29;
+	put32(&b[67], 0x54465431);
+	memcpy(&b[71], "NO NAME    FAT32   ", 19);
+	b[510] = 0x55; b[511] = 0xaa;
+	if (!img_write(&fd, 0, b) || !img_write(&fd, 6, b))
+		return 1;
+
+	memset(b, 0, sizeof b);
+	put32(&b[0], 0x41615252);
+	put32(&b[484], 0x61417272);
+	put32(&b[488], 0xffffffff);
+	put32(&b[492], 0xffffffff);
+	b[510] = 0x55; b[511] = 0xaa;
+	if (!img_write(&fd, 1, b) || !img_write(&fd, 7, b))
+		return 1;
+
+	memset(b, 0, sizeof b);
+	put32(&b[0], 0x0ffffff8);
+	put32(&b[4], 0x0fffffff);
+	put32(&b[8], 0x0fffffff);		// the root directory's one cluster
+	for (int i = 0; i < nfats; i++)
+		if (!img_write(&fd, reserved + i * fat_size, b))
+			return 1;
+	printf("%u sectors, %u clusters\n", total, (total - reserved - nfats * fat_size) / spc);
+	return 0;
+}
+
+bool mount(int &fd)
+{
+	static blockdev dev;
+	dev.read = img_read;
+	dev.write = img_write;
+	dev.ctx = &fd;
+	if (!tftstore_mount(&store, &dev, win, buf)) {
+		fprintf(stderr, "tftstore: no FAT32 volume\n");
+		return false;
+	}
+	return true;
+}
+
+int list()
+{
+	for (int i = 0; i < TFT_SLOTS; i++) {
+		const tft_entry &e = store.cat[i];
+		if (e.used)
+			printf("%d  seq %-4u %9u bytes  crc %08x  %.*s\n", i, e.seq, e.size, e.crc, TFT_MODEL_LEN, e.model);
+	}
+	return 0;
+}
+
+int put(const char *who, const char *path)
+{
+	FILE *fp = fopen(path, "rb");
+	if (!fp) {
+		fprintf(stderr, "tftstore: %s: %s\n", path, strerror(errno));
+		return 1;
+	}
+	std::vector<uint8_t> data;
+	uint8_t chunk[4096];
+	size_t n;
+	while ((n = fread(chunk, 1, sizeof chunk, fp)) > 0)
+		data.insert(data.end(), chunk, chunk + n);
+	fclose(fp);
+
+	char model[TFT_MODEL_LEN];
+	if (strncmp(who, "comok ", 6) == 0) {
+		tft_model(who, model);
+	} else {
+		memset(model, 0, sizeof model);
+		strncpy(model, who, TFT_MODEL_LEN - 1);
+	}
+	if (!tftstore_begin(&store, model, data.size(), buf, sumbuf, -1)) {
+		fprintf(stderr, "tftstore: cannot start\n");
+		return 1;
+	}
+	// odd sized pieces, so sector and cluster ends fall mid write as they do on the bridge
+	for (size_t at = 0; at < data.size(); at += 61) {
+		size_t len = data.size() - at < 61 ? data.size() - at : 61;
+		if (!tftstore_put(&store, &data[at], static_cast<uint16_t>(len))) {
+			fprintf(stderr, "tftstore: write failed at %zu\n", at);
+			return 1;
+		}
+	}
+	int slot = tftstore_end(&store);
+	if (slot < 0) {
+		fprintf(stderr, "tftstore: not stored\n");
+		return 1;
+	}
+	printf("slot %d  %u bytes  crc %08x  %s\n", slot, store.cat[slot].size, store.cat[slot].crc, model);
+	return 0;
+}
+
+// the slot's TFTn.CRC against the chunks read back; true if they match or
+// it has none (stored before there were chunk CRCs)
+bool check_sums(int slot, const std::vector<uint32_t> &sums)
+{
+	fat_file f;
+	if (!tftstore_open(&store, static_cast<int8_t>(slot), true, &f, buf)) {
+		fprintf(stderr, "tftstore: slot %d: no chunk CRCs\n", slot);
+		return true;
+	}
+	size_t i = 0;
+	uint16_t n;
+	while ((n = fat_read_sector(&f)) > 0) {
+		for (uint16_t j = 0; j + 4 <= n; j += 4, i++) {
+			uint32_t v = buf[j] | (buf[j + 1] << 8) | (buf[j + 2] << 16) | (static_cast<uint32_t>(buf[j + 3]) << 24);
+			if (i >= sums.size() || v != sums[i]) {
+				fprintf(stderr, "tftstore: slot %d: chunk %zu crc %08x, TFT%d.CRC says %08x\n", slot, i,
+				        i < sums.size() ? sums[i] : 0, slot, v);
+				return false;
+			}
+		}
+	}
+	return i == sums.size();
+}
+
+// read a slot back, to out if it is not null; true if the CRCs match
+bool read_back(int slot, FILE *out)
+{
+	fat_file f;
+	if (!tftstore_open(&store, static_cast<int8_t>(slot), false, &f, buf)) {
+		fprintf(stderr, "tftstore: slot %d: cannot open\n", slot);
+		return false;
+	}
+	uint32_t crc = CRC32_INIT, sum = CRC32_INIT, got = 0;
+	std::vector<uint32_t> sums;
+	uint16_t n;
+	while ((n = fat_read_sector(&f)) > 0) {
+		crc = crc32_block(crc, buf, n);
+		sum = crc32_block(sum, buf, n);
+		got += n;
+		if (got % TFT_CHUNK == 0) {
+			sums.push_back(crc32_final(sum));
+			sum = CRC32_INIT;
+		}
+		if (out)
+			fwrite(buf, 1, n, out);
+	}
+	if (got % TFT_CHUNK)
+		sums.push_back(crc32_final(sum));
+	crc = crc32_final(crc);
+	const tft_entry &e = store.cat[slot];
+	if (got != e.size || crc != e.crc) {
+		fprintf(stderr, "tftstore: slot %d: %u bytes crc %08x, catalogue says %u %08x\n", slot, got, crc,
+		        e.size, e.crc);
+		return false;
+	}
+	return check_sums(slot, sums);
+}
+
+int get(const char *slot, const char *path)
+{
+	FILE *fp = fopen(path, "wb");
+	if (!fp) {
+		fprintf(stderr, "tftstore: %s: %s\n", path, strerror(errno));
+		return 1;
+	}
+	bool ok = read_back(atoi(slot), fp);
+	fclose(fp);
+	return ok ? 0 : 1;
+}
+
+int check()
+{
+	int bad = 0, n = 0;
+	for (int i = 0; i < TFT_SLOTS; i++) {
+		if (!store.cat[i].used)
+			continue;
+		n++;
+		if (!read_back(i, nullptr))
+			bad++;
+	}
+	printf("%d images, %d bad\n", n, bad);
+	return bad ? 1 : 0;
+}
+
+void usage(const char *me)
+{
+	fprintf(stderr, "usage: %s <image> format <MB> | ls | put <model|comok...> <file> | get <slot> <file> | check\n", me);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+	if (argc < 3) {
+		usage(argv[0]);
+		return 2;
+	}
+	const char *cmd = argv[2];
+	int fd = open(argv[1], strcmp(cmd, "format") == 0 ? O_RDWR | O_CREAT : O_RDWR, 0644);
+	if (fd < 0) {
+		fprintf(stderr, "tftstore: %s: %s\n", argv[1], strerror(errno));
+		return 1;
+	}
+
+	int rc = 2;
+	if (strcmp(cmd, "format") == 0 && argc == 4)
+		rc = format(fd, strtol(argv[3], nullptr, 10));
+	else if (strcmp(cmd, "ls") == 0 && argc == 3)
+		rc = mount(fd) ? list() : 1;
+	else if (strcmp(cmd, "put") == 0 && argc == 5)
+		rc = mount(fd) ? put(argv[3], argv[4]) : 1;
+	else if (strcmp(cmd, "get") == 0 && argc == 5)
+		rc = mount(fd) ? get(argv[3], argv[4]) : 1;
+	else if (strcmp(cmd, "check") == 0 && argc == 3)
+		rc = mount(fd) ? check() : 1;
+	else
+		usage(argv[0]);
+	close(fd);
+	return rc;
+}